@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "Shader.h"
+#include "FrameData.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -60,6 +61,10 @@ int main()
 	// Llegim i carreguem a memria els shaders
 	Shader ourShader("res/vertexshader.vs", "res/fragmentshader.fs");
 
+	// camera matrices shared by every program through the FrameData block
+	FrameUniforms frameUniforms;
+	FrameData frame = FrameData();
+
 	//Llio 8 Textures
 	unsigned int texture;
 	glGenTextures(1, &texture);
@@ -174,18 +179,14 @@ int main()
 		// note that were translating the scene in the reverse direction
 		view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
 
-		glm::mat4 projection;
-		projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+		// one upload per frame, whatever the number of programs
+		frame.view = view;
+		frame.projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+		frameUniforms.update(frame);
 
 		int modelLoc = glGetUniformLocation(ourShader.ID, "model");
 		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
-		int viewlLoc = glGetUniformLocation(ourShader.ID, "view");
-		glUniformMatrix4fv(viewlLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-		int projectionLoc = glGetUniformLocation(ourShader.ID, "projection");
-		glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
 
 		ourShader.use();
 
@@ -198,6 +199,7 @@ int main()
 
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &frameUniforms.ID);
 	
 	// Lliberar recursos
 	glfwTerminate();
@@ -19,5 +19,8 @@ public:
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
 	void setFloat(const std::string& name, float value) const;
+
+private:
+	void bindUniformBlocks();
 };
 #endif
\ No newline at end of file
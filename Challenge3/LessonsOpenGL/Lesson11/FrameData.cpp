@@ -0,0 +1,22 @@
+#include "FrameData.h"
+
+#include <glad/glad.h>
+
+const char* const FrameUniforms::blockName = "FrameData";
+
+FrameUniforms::FrameUniforms()
+{
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_UNIFORM_BUFFER, ID);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	// the binding never changes, so programs only need their block index bound once
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+}
+
+void FrameUniforms::update(const FrameData& data)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, ID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -1,4 +1,5 @@
 #include "Shader.h"
+#include "FrameData.h"
 
 #include <glad/glad.h> // include glad to get the required OpenGL headers
 #include <string>
@@ -87,6 +88,16 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
 
+	// 3. hook up the shared uniform blocks
+	bindUniformBlocks();
+}
+
+void Shader::bindUniformBlocks()
+{
+	// the block index is per program, the binding point is fixed for the whole app
+	unsigned int frameBlock = glGetUniformBlockIndex(ID, FrameUniforms::blockName);
+	if (frameBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, frameBlock, FrameUniforms::binding);
 }
 
 void Shader::use()
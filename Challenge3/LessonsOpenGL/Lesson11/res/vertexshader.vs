@@ -6,8 +6,14 @@ out vec2 TexCoord;
 
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// camera data shared by every program, uploaded once per frame
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 screen;
+};
 
 void main()
 {
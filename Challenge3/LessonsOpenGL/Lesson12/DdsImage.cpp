@@ -0,0 +1,169 @@
+#include "DdsImage.h"
+
+#include <glad/glad.h>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	const uint32_t ddsMagic = 0x20534444;	// "DDS "
+	const uint32_t fourCCFlag = 0x4;
+	const size_t headerSize = 4 + 124;
+	const size_t dx10HeaderSize = 20;
+
+	uint32_t fourCC(const char* code)
+	{
+		return (uint32_t)code[0] | ((uint32_t)code[1] << 8) | ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+	}
+
+	uint32_t read32(const unsigned char* bytes)
+	{
+		return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+	}
+
+	// DXGI_FORMAT values of the DX10 extension header
+	unsigned int dxgiFormat(uint32_t format)
+	{
+		switch (format)
+		{
+		case 71: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;	// BC1_UNORM
+		case 77: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;	// BC3_UNORM
+		case 80: return GL_COMPRESSED_RED_RGTC1;	// BC4_UNORM
+		case 98: return GL_COMPRESSED_RGBA_BPTC_UNORM;	// BC7_UNORM
+		default: return 0;
+		}
+	}
+}
+
+bool DdsImage::isDds(const std::string& path)
+{
+	if (path.size() < 4)
+		return false;
+	std::string extension = path.substr(path.size() - 4);
+	for (char& c : extension)
+		c = (char)tolower((unsigned char)c);
+	return extension == ".dds";
+}
+
+bool DdsImage::formatSupported(unsigned int format)
+{
+	switch (format)
+	{
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return GLAD_GL_EXT_texture_compression_s3tc;
+	case GL_COMPRESSED_RED_RGTC1:
+		// core since GL 3.0
+		return true;
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		return GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_compression_bptc;
+	default:
+		return false;
+	}
+}
+
+size_t DdsImage::size() const
+{
+	size_t total = 0;
+	for (const DdsLevel& level : levels)
+		total += level.size;
+	return total;
+}
+
+bool DdsImage::load(const std::string& path)
+{
+	file = std::make_unique<MappedFile>();
+	if (!file->open(path))
+	{
+		errorMessage = file->error();
+		file.reset();
+		return false;
+	}
+	// the levels are uploaded in file order, later: have it read in now
+	file->adviseSequential();
+	if (!parse(path))
+	{
+		file.reset();
+		levels.clear();
+		format = 0;
+		return false;
+	}
+	return true;
+}
+
+bool DdsImage::parse(const std::string& path)
+{
+	if (file->size() < headerSize || read32(bytes()) != ddsMagic || read32(bytes() + 4) != 124)
+	{
+		errorMessage = path + ": not a DDS file";
+		return false;
+	}
+	const unsigned char* header = bytes() + 4;
+	height = (int)read32(header + 8);
+	width = (int)read32(header + 12);
+	uint32_t mipCount = read32(header + 24);
+	// DDS_PIXELFORMAT is at offset 72 of the header
+	uint32_t pixelFlags = read32(header + 76);
+	uint32_t code = read32(header + 80);
+	size_t offset = headerSize;
+
+	format = 0;
+	if (pixelFlags & fourCCFlag)
+	{
+		if (code == fourCC("DXT1"))
+			format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		else if (code == fourCC("DXT5"))
+			format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		else if (code == fourCC("ATI1") || code == fourCC("BC4U"))
+			format = GL_COMPRESSED_RED_RGTC1;
+		else if (code == fourCC("DX10"))
+		{
+			if (file->size() < headerSize + dx10HeaderSize)
+			{
+				errorMessage = path + ": truncated DX10 header";
+				return false;
+			}
+			const unsigned char* dx10 = bytes() + headerSize;
+			// resource dimension 3 is TEXTURE2D; arrays are not supported
+			if (read32(dx10 + 4) != 3 || read32(dx10 + 12) > 1)
+			{
+				errorMessage = path + ": not a single 2D texture";
+				return false;
+			}
+			format = dxgiFormat(read32(dx10));
+			offset += dx10HeaderSize;
+		}
+	}
+	if (format == 0)
+	{
+		errorMessage = path + ": unsupported pixel format";
+		return false;
+	}
+	if (width <= 0 || height <= 0)
+	{
+		errorMessage = path + ": bad size";
+		return false;
+	}
+
+	// BC1 and BC4 take 8 bytes per 4x4 block, BC3 and BC7 16
+	size_t blockBytes = format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT || format == GL_COMPRESSED_RED_RGTC1 ? 8 : 16;
+	levels.clear();
+	int w = width, h = height;
+	for (uint32_t i = 0; i < (mipCount ? mipCount : 1); i++)
+	{
+		size_t size = (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+		if (offset + size > file->size())
+		{
+			errorMessage = path + ": truncated mip level " + std::to_string(i);
+			return false;
+		}
+		levels.push_back({ w, h, offset, size });
+		offset += size;
+		if (w == 1 && h == 1)
+			break;
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef DDSIMAGE_H
+#define DDSIMAGE_H
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// one mip level of a block-compressed image: a slice of the file
+struct DdsLevel
+{
+	int width;
+	int height;
+	size_t offset;
+	size_t size;
+};
+
+// A DDS file holding a block-compressed 2D texture and its prebuilt mip chain
+// (see tools/texconv). The file is mapped, not read, and the levels point into
+// the mapping: uploading is up to the caller, one glCompressedTexImage2D per
+// level, straight from the file's pages.
+class DdsImage
+{
+public:
+	// GL internal format (GL_COMPRESSED_*), 0 until loaded
+	unsigned int format = 0;
+	int width = 0;
+	int height = 0;
+	std::vector<DdsLevel> levels;
+
+	// maps the file; false with error() set if it is not a DDS file in one of
+	// the formats below (BC1, BC3, BC4, BC7)
+	bool load(const std::string& path);
+	const unsigned char* levelData(size_t level) const { return bytes() + levels[level].offset; }
+	// compressed size of every level together
+	size_t size() const;
+	const std::string& error() const { return errorMessage; }
+
+	// true for paths ending in .dds
+	static bool isDds(const std::string& path);
+	// the driver can sample the format (S3TC is an extension, BPTC is GL 4.2)
+	static bool formatSupported(unsigned int format);
+
+private:
+	std::unique_ptr<MappedFile> file;
+	std::string errorMessage;
+
+	const unsigned char* bytes() const { return reinterpret_cast<const unsigned char*>(file->data()); }
+	bool parse(const std::string& path);
+};
+#endif
@@ -0,0 +1,254 @@
+#include "DecodeArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+	// the arena of the scope the thread is in, if any
+	thread_local DecodeArena* threadArena = nullptr;
+
+	size_t roundUp(size_t size, size_t multiple)
+	{
+		return (size + multiple - 1) / multiple * multiple;
+	}
+}
+
+// a chunk is one malloc: this, then the blocks
+struct alignas(16) DecodeArena::Chunk
+{
+	// null once the arena is gone
+	DecodeArena* owner;
+	// blocks in use, plus one while it is the arena's current chunk
+	std::atomic<int> references;
+	size_t capacity;
+	size_t used;
+
+	unsigned char* data() { return reinterpret_cast<unsigned char*>(this + 1); }
+};
+
+// in front of every block; 16 bytes, so blocks stay 16-byte aligned
+struct alignas(16) DecodeArena::Header
+{
+	// null for blocks from malloc
+	Chunk* chunk;
+	size_t size;
+};
+
+DecodeArena::DecodeArena(size_t chunkSize)
+	: chunkSize(chunkSize), current(nullptr)
+{
+}
+
+DecodeArena::~DecodeArena()
+{
+	if (current)
+		current->references--;
+	current = nullptr;
+	for (Chunk* chunk : chunks)
+	{
+		if (chunk->references == 0)
+		{
+			chunk->~Chunk();
+			std::free(chunk);
+		}
+		else
+			chunk->owner = nullptr;
+	}
+}
+
+DecodeArena::Scope::Scope(DecodeArena& arena)
+	: arena(arena), previous(threadArena)
+{
+	threadArena = &arena;
+}
+
+DecodeArena::Scope::~Scope()
+{
+	threadArena = previous;
+	// what is left of the image is the image itself, usually in a chunk of its
+	// own: if nothing is, the next image starts at the beginning of the chunk
+	if (arena.current && arena.current->references == 1)
+		arena.current->used = 0;
+
+	std::lock_guard<std::mutex> lock(arena.mutex);
+	arena.totals.images++;
+	arena.totals.allocations += arena.pending.allocations;
+	arena.totals.reallocations += arena.pending.reallocations;
+	arena.totals.grownInPlace += arena.pending.grownInPlace;
+	arena.totals.bytesRequested += arena.pending.bytesRequested;
+	arena.pending = DecodeArenaStats();
+}
+
+DecodeArenaStats DecodeArena::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return totals;
+}
+
+void* DecodeArena::allocate(size_t size)
+{
+	if (threadArena)
+		return threadArena->carve(size);
+	Header* header = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+	if (!header)
+		return nullptr;
+	header->chunk = nullptr;
+	header->size = size;
+	return header + 1;
+}
+
+void* DecodeArena::reallocate(void* block, size_t, size_t newSize)
+{
+	if (!block)
+		return allocate(newSize);
+	Header* header = static_cast<Header*>(block) - 1;
+	Chunk* chunk = header->chunk;
+	DecodeArena* arena = threadArena;
+	if (arena)
+		arena->pending.reallocations++;
+
+	// the last block of a chunk of this thread's arena grows where it is: the
+	// inflated PNG data doubles until it fits
+	if (arena && chunk && chunk->owner == arena)
+	{
+		size_t offset = reinterpret_cast<unsigned char*>(header) - chunk->data();
+		size_t oldBytes = roundUp(sizeof(Header) + header->size, 16);
+		size_t newBytes = roundUp(sizeof(Header) + newSize, 16);
+		if (offset + oldBytes == chunk->used && offset + newBytes <= chunk->capacity)
+		{
+			chunk->used = offset + newBytes;
+			header->size = newSize;
+			arena->pending.grownInPlace++;
+			return block;
+		}
+	}
+
+	void* moved = allocate(newSize);
+	if (!moved)
+		return nullptr;
+	std::memcpy(moved, block, std::min(header->size, newSize));
+	release(block);
+	return moved;
+}
+
+void DecodeArena::release(void* block)
+{
+	if (!block)
+		return;
+	Header* header = static_cast<Header*>(block) - 1;
+	if (header->chunk)
+		unreference(header->chunk);
+	else
+		std::free(header);
+}
+
+void* DecodeArena::carve(size_t size)
+{
+	size_t bytes = roundUp(sizeof(Header) + size, 16);
+	Chunk* chunk;
+	if (bytes > chunkSize / 2)
+	{
+		// big blocks get a chunk of their own, so they free it as a whole
+		chunk = takeChunk(bytes);
+		if (!chunk)
+			return nullptr;
+	}
+	else
+	{
+		if (!current || current->capacity - current->used < bytes)
+		{
+			Chunk* next = takeChunk(chunkSize);
+			if (!next)
+				return nullptr;
+			if (current)
+				unreference(current);
+			current = next;
+			current->references++;
+		}
+		chunk = current;
+	}
+
+	Header* header = reinterpret_cast<Header*>(chunk->data() + chunk->used);
+	chunk->used += bytes;
+	chunk->references++;
+	header->chunk = chunk;
+	header->size = size;
+	pending.allocations++;
+	pending.bytesRequested += size;
+	return header + 1;
+}
+
+DecodeArena::Chunk* DecodeArena::takeChunk(size_t bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// the smallest idle chunk the block fits in
+		auto best = idle.end();
+		for (auto chunk = idle.begin(); chunk != idle.end(); ++chunk)
+			if ((*chunk)->capacity >= bytes && (best == idle.end() || (*chunk)->capacity < (*best)->capacity))
+				best = chunk;
+		if (best != idle.end())
+		{
+			Chunk* chunk = *best;
+			idle.erase(best);
+			chunk->used = 0;
+			totals.chunksReused++;
+			return chunk;
+		}
+
+		// none fits: the big idle chunks too small for it are of images smaller
+		// than the ones coming, give them back rather than keep them forever
+		for (size_t i = 0; i < idle.size(); )
+		{
+			Chunk* chunk = idle[i];
+			if (chunk->capacity > chunkSize)
+			{
+				idle[i] = idle.back();
+				idle.pop_back();
+				chunks.erase(std::find(chunks.begin(), chunks.end(), chunk));
+				totals.bytesHeld -= chunk->capacity;
+				chunk->~Chunk();
+				std::free(chunk);
+			}
+			else
+				i++;
+		}
+	}
+
+	// sizes in whole megabytes, so chunks fit the next image of about the same size
+	size_t capacity = std::max(chunkSize, roundUp(bytes, 1 << 20));
+	void* memory = std::malloc(sizeof(Chunk) + capacity);
+	if (!memory)
+		return nullptr;
+	Chunk* chunk = new (memory) Chunk;
+	chunk->owner = this;
+	chunk->references = 0;
+	chunk->capacity = capacity;
+	chunk->used = 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	chunks.push_back(chunk);
+	totals.chunksAllocated++;
+	totals.bytesHeld += capacity;
+	return chunk;
+}
+
+void DecodeArena::unreference(Chunk* chunk)
+{
+	if (--chunk->references != 0)
+		return;
+	DecodeArena* owner = chunk->owner;
+	if (!owner)
+	{
+		// the arena is gone: the last block takes the chunk with it
+		chunk->~Chunk();
+		std::free(chunk);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(owner->mutex);
+	owner->idle.push_back(chunk);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#ifndef DECODEARENA_H
+#define DECODEARENA_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// what a DecodeArena did, since it was made
+struct DecodeArenaStats
+{
+	// images decoded with it (scopes closed)
+	size_t images = 0;
+	// STBI_MALLOC calls, STBI_REALLOC_SIZED calls and how many of those grew
+	// the last block in place
+	size_t allocations = 0;
+	size_t reallocations = 0;
+	size_t grownInPlace = 0;
+	size_t bytesRequested = 0;
+	// chunks taken from malloc vs. used again after the blocks in them were freed
+	size_t chunksAllocated = 0;
+	size_t chunksReused = 0;
+	// memory held in chunks
+	size_t bytesHeld = 0;
+};
+
+// Memory for what stb_image allocates while it decodes (StbImage.cpp points
+// STBI_MALLOC, STBI_REALLOC_SIZED and STBI_FREE here): component planes, line
+// buffers, the inflated PNG data, the image itself. Each decoding thread has
+// its own arena and carves the blocks out of chunks it keeps from one image to
+// the next, so once warmed up a decode takes no lock and calls malloc for
+// nothing. A chunk is used again once every block in it is freed, from any
+// thread: the decoded pixels are freed by the GL thread, after the upload.
+// Blocks allocated on a thread without an arena come from malloc.
+class DecodeArena
+{
+public:
+	// chunks are at least chunkSize bytes; a block over half of that gets a
+	// chunk of its own
+	explicit DecodeArena(size_t chunkSize = 4 << 20);
+	// frees the chunks nobody uses; one still holding blocks is freed with its
+	// last block. No other thread may free blocks of the arena meanwhile
+	~DecodeArena();
+	DecodeArena(const DecodeArena&) = delete;
+	DecodeArena& operator=(const DecodeArena&) = delete;
+
+	// the calling thread allocates from the arena while the scope lives (one
+	// image); closing it starts the arena's current chunk over if it is empty
+	class Scope
+	{
+	public:
+		explicit Scope(DecodeArena& arena);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		DecodeArena& arena;
+		DecodeArena* previous;
+	};
+
+	DecodeArenaStats stats() const;
+
+	// STBI_MALLOC, STBI_REALLOC_SIZED and STBI_FREE
+	static void* allocate(size_t size);
+	static void* reallocate(void* block, size_t oldSize, size_t newSize);
+	static void release(void* block);
+
+private:
+	struct Chunk;
+	struct Header;
+
+	size_t chunkSize;
+	// where small blocks are carved from; the arena holds a reference on it
+	Chunk* current;
+	// every chunk of the arena, and the ones with no block in use
+	std::vector<Chunk*> chunks;
+	std::vector<Chunk*> idle;
+	// counted by the owning thread, added to totals when a scope closes
+	DecodeArenaStats pending;
+	DecodeArenaStats totals;
+	// guards chunks, idle and totals: chunks come back from other threads
+	mutable std::mutex mutex;
+
+	void* carve(size_t size);
+	Chunk* takeChunk(size_t bytes);
+	static void unreference(Chunk* chunk);
+};
+#endif
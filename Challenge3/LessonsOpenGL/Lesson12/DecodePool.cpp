@@ -0,0 +1,92 @@
+#include "DecodePool.h"
+
+#include <algorithm>
+
+#include "stb_image.h"
+
+DecodePool::DecodePool(int threadCount)
+	: stopping(false), installed(false)
+{
+	for (int i = 0; i < threadCount; i++)
+		threads.emplace_back(&DecodePool::work, this);
+}
+
+DecodePool::~DecodePool()
+{
+	uninstall();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+void DecodePool::install()
+{
+	stbi_set_parallel_for(&DecodePool::parallelFor, this);
+	installed = true;
+}
+
+void DecodePool::uninstall()
+{
+	if (installed)
+		stbi_set_parallel_for(NULL, NULL);
+	installed = false;
+}
+
+void DecodePool::parallelFor(void (*task)(void*, int), void* taskUser, int count, void* user)
+{
+	static_cast<DecodePool*>(user)->run(task, taskUser, count);
+}
+
+void DecodePool::run(void (*task)(void*, int), void* taskUser, int count)
+{
+	Batch batch = { task, taskUser, count, 0, 0, 0 };
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!threads.empty() && count > 1)
+	{
+		batches.push_back(&batch);
+		wake.notify_all();
+	}
+	drain(batch, lock);
+	// the batch lives on this stack: wait for the last thread to let go of it
+	finished.wait(lock, [&batch] { return batch.done == batch.count && batch.users == 0; });
+	auto queued = std::find(batches.begin(), batches.end(), &batch);
+	if (queued != batches.end())
+		batches.erase(queued);
+}
+
+void DecodePool::drain(Batch& batch, std::unique_lock<std::mutex>& lock)
+{
+	while (batch.next < batch.count)
+	{
+		int index = batch.next++;
+		lock.unlock();
+		batch.task(batch.taskUser, index);
+		lock.lock();
+		if (++batch.done == batch.count)
+			finished.notify_all();
+	}
+}
+
+void DecodePool::work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		wake.wait(lock, [this] { return stopping || !batches.empty(); });
+		if (stopping)
+			return;
+		// the batch stays queued while it has tasks, so the other threads help too
+		Batch* batch = batches.front();
+		batch->users++;
+		drain(*batch, lock);
+		auto queued = std::find(batches.begin(), batches.end(), batch);
+		if (queued != batches.end())
+			batches.erase(queued);
+		batch->users--;
+		finished.notify_all();
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef DECODEPOOL_H
+#define DECODEPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads stb_image spreads the work of one image over (stbi_set_parallel_for):
+// the restart intervals of a JPEG and its color conversion, in bands of rows.
+// Any number of threads can decode at once (the streamer's workers); each
+// call runs its tasks on the pool and on the calling thread, and returns when
+// they are done.
+class DecodePool
+{
+public:
+	// threads besides the callers'; 0 decodes on the calling thread only
+	explicit DecodePool(int threadCount);
+	// uninstalls the pool if it is installed, and joins the threads
+	~DecodePool();
+	DecodePool(const DecodePool&) = delete;
+	DecodePool& operator=(const DecodePool&) = delete;
+
+	// makes stb_image use this pool (for every thread) until uninstall()
+	void install();
+	void uninstall();
+	// runs task(taskUser, 0..count-1) across the pool; stbi_parallel_for
+	void run(void (*task)(void*, int), void* taskUser, int count);
+
+	int threadCount() const { return (int)threads.size(); }
+
+private:
+	// one run() call: tasks are claimed by index until none is left
+	struct Batch
+	{
+		void (*task)(void*, int);
+		void* taskUser;
+		int count;
+		int next;
+		int done;
+		// pool threads working on it right now
+		int users;
+	};
+
+	std::vector<std::thread> threads;
+	std::deque<Batch*> batches;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	bool stopping;
+	bool installed;
+
+	void work();
+	// runs tasks of the batch until none is left to claim; mutex held on entry and exit
+	void drain(Batch& batch, std::unique_lock<std::mutex>& lock);
+	static void parallelFor(void (*task)(void*, int), void* taskUser, int count, void* user);
+};
+#endif
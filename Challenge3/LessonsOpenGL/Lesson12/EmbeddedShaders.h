@@ -0,0 +1,154 @@
+// Generated by tools/embed_shaders.cpp from res/ - do not edit.
+#pragma once
+
+#ifndef EMBEDDEDSHADERS_H
+#define EMBEDDEDSHADERS_H
+
+#include <string_view>
+
+struct EmbeddedShader
+{
+	std::string_view path;
+	std::string_view source;
+};
+
+inline constexpr EmbeddedShader embeddedShaders[] = {
+	{ "res/cube.opt.vs",
+		"#version 330 core\r\n"
+		"// generated by tools/hoist_uniforms from cube.vs: products computed once per draw on the CPU\r\n"
+		"uniform mat4 projection_view_model;\r\n"
+		"layout (location = 0) in vec3 aPos;\t\t// position has attribute position 0\r\n"
+		"layout (location = 1) in vec2 aTexCoord;\r\n"
+		"\r\n"
+		"out vec2 TexCoords;\r\n"
+		"\r\n"
+		"\r\n"
+		"uniform mat4 model;\r\n"
+		"\r\n"
+		"#include \"framedata.glsl\"\r\n"
+		"\r\n"
+		"void main()\r\n"
+		"{\r\n"
+		"\tgl_Position = projection_view_model * vec4(aPos, 1.0f);\r\n"
+		"\tTexCoords = vec2(aTexCoord.x, aTexCoord.y);\r\n"
+		"}" },
+	{ "res/cube.vs",
+		"#version 330 core\r\n"
+		"layout (location = 0) in vec3 aPos;\t\t// position has attribute position 0\r\n"
+		"layout (location = 1) in vec2 aTexCoord;\r\n"
+		"\r\n"
+		"out vec2 TexCoords;\r\n"
+		"\r\n"
+		"\r\n"
+		"uniform mat4 model;\r\n"
+		"\r\n"
+		"#include \"framedata.glsl\"\r\n"
+		"\r\n"
+		"void main()\r\n"
+		"{\r\n"
+		"\tgl_Position = projection * view * model * vec4(aPos, 1.0f);\r\n"
+		"\tTexCoords = vec2(aTexCoord.x, aTexCoord.y);\r\n"
+		"}" },
+	{ "res/cube_pulled.opt.vs",
+		"#version 430 core\r\n"
+		"// generated by tools/hoist_uniforms from cube_pulled.vs: products computed once per draw on the CPU\r\n"
+		"uniform mat4 projection_view_model;\r\n"
+		"// vertex pulling (VertexStorage.h): no attributes, every mesh is read from\r\n"
+		"// the storage buffers by gl_VertexID, whatever its layout\r\n"
+		"layout (std430, binding = 1) readonly buffer Vertices\r\n"
+		"{\r\n"
+		"\tfloat vertices[];\r\n"
+		"};\r\n"
+		"// per mesh: first float, stride, position and texture coordinate offsets (-1 if absent)\r\n"
+		"layout (std430, binding = 2) readonly buffer Meshes\r\n"
+		"{\r\n"
+		"\tivec4 meshes[];\r\n"
+		"};\r\n"
+		"\r\n"
+		"out vec2 TexCoords;\r\n"
+		"\r\n"
+		"\r\n"
+		"uniform mat4 model;\r\n"
+		"uniform int mesh;\r\n"
+		"\r\n"
+		"#include \"framedata.glsl\"\r\n"
+		"\r\n"
+		"void main()\r\n"
+		"{\r\n"
+		"\tivec4 m = meshes[mesh];\r\n"
+		"\tint first = m.x + gl_VertexID * m.y;\r\n"
+		"\tvec3 aPos = vec3(vertices[first + m.z], vertices[first + m.z + 1], vertices[first + m.z + 2]);\r\n"
+		"\tvec2 aTexCoord = m.w >= 0 ? vec2(vertices[first + m.w], vertices[first + m.w + 1]) : vec2(0.0);\r\n"
+		"\tgl_Position = projection_view_model * vec4(aPos, 1.0f);\r\n"
+		"\tTexCoords = aTexCoord;\r\n"
+		"}" },
+	{ "res/cube_pulled.vs",
+		"#version 430 core\r\n"
+		"// vertex pulling (VertexStorage.h): no attributes, every mesh is read from\r\n"
+		"// the storage buffers by gl_VertexID, whatever its layout\r\n"
+		"layout (std430, binding = 1) readonly buffer Vertices\r\n"
+		"{\r\n"
+		"\tfloat vertices[];\r\n"
+		"};\r\n"
+		"// per mesh: first float, stride, position and texture coordinate offsets (-1 if absent)\r\n"
+		"layout (std430, binding = 2) readonly buffer Meshes\r\n"
+		"{\r\n"
+		"\tivec4 meshes[];\r\n"
+		"};\r\n"
+		"\r\n"
+		"out vec2 TexCoords;\r\n"
+		"\r\n"
+		"\r\n"
+		"uniform mat4 model;\r\n"
+		"uniform int mesh;\r\n"
+		"\r\n"
+		"#include \"framedata.glsl\"\r\n"
+		"\r\n"
+		"void main()\r\n"
+		"{\r\n"
+		"\tivec4 m = meshes[mesh];\r\n"
+		"\tint first = m.x + gl_VertexID * m.y;\r\n"
+		"\tvec3 aPos = vec3(vertices[first + m.z], vertices[first + m.z + 1], vertices[first + m.z + 2]);\r\n"
+		"\tvec2 aTexCoord = m.w >= 0 ? vec2(vertices[first + m.w], vertices[first + m.w + 1]) : vec2(0.0);\r\n"
+		"\tgl_Position = projection * view * model * vec4(aPos, 1.0f);\r\n"
+		"\tTexCoords = aTexCoord;\r\n"
+		"}" },
+	{ "res/fragmentshader.fs",
+		"#version 330 core\r\n"
+		"in vec2 TexCoords;\r\n"
+		"out vec4 color;\r\n"
+		"uniform sampler2D image;\r\n"
+		"#ifdef TEXT\r\n"
+		"// glyph coverage is in the red channel\r\n"
+		"uniform vec3 textColor;\r\n"
+		"#endif\r\n"
+		"void main()\r\n"
+		"{\r\n"
+		"#ifdef TEXT\r\n"
+		"vec4 sampled = vec4(1.0, 1.0, 1.0, texture(image, TexCoords).r);\r\n"
+		"color = vec4(textColor, 1.0) * sampled;\r\n"
+		"#else\r\n"
+		"color = texture(image, TexCoords);\r\n"
+		"#endif\r\n"
+		"}" },
+	{ "res/framedata.glsl",
+		"// camera data shared by every program, uploaded once per frame (FrameData.h)\r\n"
+		"layout (std140) uniform FrameData\r\n"
+		"{\r\n"
+		"\tmat4 view;\r\n"
+		"\tmat4 projection;\r\n"
+		"\tmat4 screen;\r\n"
+		"};" },
+	{ "res/vertexshader.vs",
+		"#version 330 core\r\n"
+		"layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>\r\n"
+		"out vec2 TexCoords;\r\n"
+		"#include \"framedata.glsl\"\r\n"
+		"void main()\r\n"
+		"{\r\n"
+		"gl_Position = screen * vec4(vertex.xy, 0.0, 1.0);\r\n"
+		"TexCoords = vertex.zw;\r\n"
+		"}" },
+};
+
+#endif
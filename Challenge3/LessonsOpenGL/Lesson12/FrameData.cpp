@@ -0,0 +1,37 @@
+#include "FrameData.h"
+
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+const char* const FrameUniforms::blockName = "FrameData";
+FrameData FrameUniforms::current = FrameData();
+
+FrameUniforms::FrameUniforms()
+{
+	glGenBuffers(1, &ID);
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, ID);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+	// the binding never changes, so programs only need their block index bound once
+	GLState::bindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+}
+
+void FrameUniforms::update(const FrameData& data)
+{
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, ID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+	current = data;
+}
+
+const glm::mat4* FrameUniforms::member(std::string_view name)
+{
+	if (name == "view")
+		return &current.view;
+	if (name == "projection")
+		return &current.projection;
+	if (name == "screen")
+		return &current.screen;
+	return nullptr;
+}
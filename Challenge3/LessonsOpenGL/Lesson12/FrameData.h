@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef FRAMEDATA_H
+#define FRAMEDATA_H
+
+#include <cstddef>
+#include <string_view>
+
+#include <glm/glm.hpp>
+
+// Per-frame camera data, mirrored by the std140 block declared in the shaders:
+//
+//	layout (std140) uniform FrameData
+//	{
+//		mat4 view;
+//		mat4 projection;
+//		mat4 screen;
+//	};
+//
+// std140 puts every mat4 on a 16-byte boundary and rounds the block size up to
+// 16 bytes; the static asserts below catch any member that breaks that.
+struct FrameData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	// orthographic projection in window pixels, used by the text shader
+	glm::mat4 screen;
+};
+static_assert(sizeof(glm::mat4) == 64, "std140 mat4 is 4 columns of vec4");
+static_assert(offsetof(FrameData, view) == 0, "FrameData.view must be at offset 0");
+static_assert(offsetof(FrameData, projection) == 64, "FrameData.projection must be at offset 64");
+static_assert(offsetof(FrameData, screen) == 128, "FrameData.screen must be at offset 128");
+static_assert(sizeof(FrameData) % 16 == 0, "std140 block size is a multiple of 16");
+
+// Uniform buffer holding FrameData, bound once at a fixed binding point.
+// Shader binds its FrameData block to the same point at link time.
+class FrameUniforms
+{
+public:
+	static const unsigned int binding = 0;
+	static const char* const blockName;
+
+	// the buffer ID
+	unsigned int ID;
+	FrameUniforms();
+	// uploads the camera data for this frame; call once per frame
+	void update(const FrameData& data);
+
+	// the data of the last update, for uniforms derived from it on the CPU
+	static FrameData current;
+	// member of current by its name in the block, nullptr if there is none
+	static const glm::mat4* member(std::string_view name);
+};
+#endif
@@ -0,0 +1,262 @@
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+GLStateStats GLState::frameStats;
+
+namespace
+{
+	// marks a cached value as unknown, so the next call is always issued
+	const unsigned int UNKNOWN = 0xFFFFFFFFu;
+
+	const unsigned int bufferTargets[] = {
+		GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_PACK_BUFFER,
+		GL_PIXEL_UNPACK_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_TEXTURE_BUFFER,
+		GL_DRAW_INDIRECT_BUFFER, GL_SHADER_STORAGE_BUFFER
+	};
+	// targets with indexed binding points (glBindBufferBase)
+	const unsigned int indexedTargets[] = {
+		GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER, GL_ATOMIC_COUNTER_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER
+	};
+	const unsigned int textureTargets[] = {
+		GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP
+	};
+	const unsigned int capabilities[] = {
+		GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST,
+		GL_POLYGON_OFFSET_FILL, GL_MULTISAMPLE, GL_FRAMEBUFFER_SRGB
+	};
+	const int BUFFER_TARGETS = sizeof(bufferTargets) / sizeof(bufferTargets[0]);
+	const int INDEXED_TARGETS = sizeof(indexedTargets) / sizeof(indexedTargets[0]);
+	const int TEXTURE_TARGETS = sizeof(textureTargets) / sizeof(textureTargets[0]);
+	const int CAPABILITIES = sizeof(capabilities) / sizeof(capabilities[0]);
+	const int TEXTURE_UNITS = 16;
+	const int BINDING_POINTS = 16;
+
+	struct State
+	{
+		unsigned int program;
+		unsigned int pipeline;
+		unsigned int vao;
+		unsigned int buffers[BUFFER_TARGETS];
+		unsigned int indexedBuffers[INDEXED_TARGETS][BINDING_POINTS];
+		unsigned int activeUnit;
+		unsigned int textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+		unsigned int enabled[CAPABILITIES];
+		unsigned int blendSrc, blendDst;
+		unsigned int depthFunc;
+		unsigned int depthMask;
+	};
+
+	State makeUnknownState()
+	{
+		State s;
+		s.program = UNKNOWN;
+		s.pipeline = UNKNOWN;
+		s.vao = UNKNOWN;
+		for (int i = 0; i < BUFFER_TARGETS; i++)
+			s.buffers[i] = UNKNOWN;
+		for (int t = 0; t < INDEXED_TARGETS; t++)
+			for (int i = 0; i < BINDING_POINTS; i++)
+				s.indexedBuffers[t][i] = UNKNOWN;
+		s.activeUnit = UNKNOWN;
+		for (int u = 0; u < TEXTURE_UNITS; u++)
+			for (int t = 0; t < TEXTURE_TARGETS; t++)
+				s.textures[u][t] = UNKNOWN;
+		for (int i = 0; i < CAPABILITIES; i++)
+			s.enabled[i] = UNKNOWN;
+		s.blendSrc = s.blendDst = UNKNOWN;
+		s.depthFunc = UNKNOWN;
+		s.depthMask = UNKNOWN;
+		return s;
+	}
+
+	State state = makeUnknownState();
+
+	int indexOf(const unsigned int* values, int count, unsigned int value)
+	{
+		for (int i = 0; i < count; i++)
+			if (values[i] == value)
+				return i;
+		return -1;
+	}
+
+	// updates a cached value; true if the GL call has to be issued
+	bool changes(unsigned int& cached, unsigned int value)
+	{
+		if (cached == value)
+		{
+			GLState::frameStats.suppressed++;
+			return false;
+		}
+		cached = value;
+		GLState::frameStats.issued++;
+		return true;
+	}
+
+	// state we do not track is always passed through
+	void passThrough()
+	{
+		GLState::frameStats.issued++;
+	}
+
+	void setCapability(unsigned int cap, bool on)
+	{
+		int slot = indexOf(capabilities, CAPABILITIES, cap);
+		if (slot >= 0 && !changes(state.enabled[slot], on ? 1u : 0u))
+			return;
+		if (slot < 0)
+			passThrough();
+		if (on)
+			glEnable(cap);
+		else
+			glDisable(cap);
+	}
+}
+
+void GLState::useProgram(unsigned int program)
+{
+	if (changes(state.program, program))
+		glUseProgram(program);
+}
+
+void GLState::bindProgramPipeline(unsigned int pipeline)
+{
+	if (changes(state.pipeline, pipeline))
+		glBindProgramPipeline(pipeline);
+}
+
+void GLState::bindVertexArray(unsigned int vao)
+{
+	if (changes(state.vao, vao))
+	{
+		glBindVertexArray(vao);
+		// the element array binding is part of the VAO
+		state.buffers[indexOf(bufferTargets, BUFFER_TARGETS, GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+	}
+}
+
+void GLState::bindBuffer(unsigned int target, unsigned int buffer)
+{
+	int slot = indexOf(bufferTargets, BUFFER_TARGETS, target);
+	if (slot < 0)
+	{
+		passThrough();
+		glBindBuffer(target, buffer);
+	}
+	else if (changes(state.buffers[slot], buffer))
+	{
+		glBindBuffer(target, buffer);
+	}
+}
+
+void GLState::bindBufferBase(unsigned int target, unsigned int index, unsigned int buffer)
+{
+	int indexed = indexOf(indexedTargets, INDEXED_TARGETS, target);
+	if (indexed < 0 || index >= BINDING_POINTS)
+		passThrough();
+	else if (!changes(state.indexedBuffers[indexed][index], buffer))
+		return;
+	glBindBufferBase(target, index, buffer);
+	// the generic binding is only overwritten when the call is issued
+	int slot = indexOf(bufferTargets, BUFFER_TARGETS, target);
+	if (slot >= 0)
+		state.buffers[slot] = buffer;
+}
+
+void GLState::activeTexture(unsigned int unit)
+{
+	if (changes(state.activeUnit, unit))
+		glActiveTexture(unit);
+}
+
+void GLState::bindTexture(unsigned int target, unsigned int texture)
+{
+	unsigned int unit = state.activeUnit == UNKNOWN ? UNKNOWN : state.activeUnit - GL_TEXTURE0;
+	int slot = indexOf(textureTargets, TEXTURE_TARGETS, target);
+	if (unit >= TEXTURE_UNITS || slot < 0)
+	{
+		passThrough();
+		glBindTexture(target, texture);
+	}
+	else if (changes(state.textures[unit][slot], texture))
+	{
+		glBindTexture(target, texture);
+	}
+}
+
+void GLState::enable(unsigned int cap)
+{
+	setCapability(cap, true);
+}
+
+void GLState::disable(unsigned int cap)
+{
+	setCapability(cap, false);
+}
+
+void GLState::blendFunc(unsigned int sfactor, unsigned int dfactor)
+{
+	if (state.blendSrc == sfactor && state.blendDst == dfactor)
+	{
+		frameStats.suppressed++;
+		return;
+	}
+	state.blendSrc = sfactor;
+	state.blendDst = dfactor;
+	frameStats.issued++;
+	glBlendFunc(sfactor, dfactor);
+}
+
+void GLState::depthFunc(unsigned int func)
+{
+	if (changes(state.depthFunc, func))
+		glDepthFunc(func);
+}
+
+void GLState::depthMask(bool flag)
+{
+	if (changes(state.depthMask, flag ? 1u : 0u))
+		glDepthMask(flag ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::forgetProgram(unsigned int program)
+{
+	if (state.program == program)
+		state.program = UNKNOWN;
+}
+
+void GLState::forgetProgramPipeline(unsigned int pipeline)
+{
+	if (state.pipeline == pipeline)
+		state.pipeline = UNKNOWN;
+}
+
+void GLState::forgetVertexArray(unsigned int vao)
+{
+	if (state.vao == vao)
+		state.vao = UNKNOWN;
+}
+
+void GLState::forgetBuffer(unsigned int buffer)
+{
+	for (int i = 0; i < BUFFER_TARGETS; i++)
+		if (state.buffers[i] == buffer)
+			state.buffers[i] = UNKNOWN;
+	for (int t = 0; t < INDEXED_TARGETS; t++)
+		for (int i = 0; i < BINDING_POINTS; i++)
+			if (state.indexedBuffers[t][i] == buffer)
+				state.indexedBuffers[t][i] = UNKNOWN;
+}
+
+void GLState::forgetTexture(unsigned int texture)
+{
+	for (int u = 0; u < TEXTURE_UNITS; u++)
+		for (int t = 0; t < TEXTURE_TARGETS; t++)
+			if (state.textures[u][t] == texture)
+				state.textures[u][t] = UNKNOWN;
+}
+
+void GLState::invalidate()
+{
+	state = makeUnknownState();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+// state changes issued to the driver vs. dropped because nothing changed
+struct GLStateStats
+{
+	unsigned int issued = 0;
+	unsigned int suppressed = 0;
+};
+
+// a buffer on an indexed binding point, as glBindBufferBase takes it
+struct BufferBinding
+{
+	unsigned int target;
+	unsigned int index;
+	unsigned int buffer;
+};
+
+// Thin wrapper over the binding and fixed-function state calls that remembers
+// what is currently set and drops calls that would not change anything.
+// All code touching this state must go through it, otherwise call invalidate().
+class GLState
+{
+public:
+	static void useProgram(unsigned int program);
+	// only takes effect while no program is in use
+	static void bindProgramPipeline(unsigned int pipeline);
+	static void bindVertexArray(unsigned int vao);
+	static void bindBuffer(unsigned int target, unsigned int buffer);
+	// tracked per (target, index) for the indexed targets; an issued
+	// glBindBufferBase also changes the generic binding of target
+	static void bindBufferBase(unsigned int target, unsigned int index, unsigned int buffer);
+	// unit is GL_TEXTURE0 + i, like glActiveTexture
+	static void activeTexture(unsigned int unit);
+	// binds on the active unit
+	static void bindTexture(unsigned int target, unsigned int texture);
+	static void enable(unsigned int cap);
+	static void disable(unsigned int cap);
+	static void blendFunc(unsigned int sfactor, unsigned int dfactor);
+	static void depthFunc(unsigned int func);
+	static void depthMask(bool flag);
+
+	// objects deleted with glDelete* must be forgotten, their names get reused
+	static void forgetProgram(unsigned int program);
+	static void forgetProgramPipeline(unsigned int pipeline);
+	static void forgetVertexArray(unsigned int vao);
+	static void forgetBuffer(unsigned int buffer);
+	static void forgetTexture(unsigned int texture);
+	// forget everything, e.g. after code that calls GL directly
+	static void invalidate();
+
+	// counters for the current frame
+	static GLStateStats frameStats;
+	static void resetFrameStats() { frameStats = GLStateStats(); }
+};
+#endif
@@ -1,16 +1,29 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <map>
+#include <optional>
+#include <thread>
+#include <vector>
 #include "Shader.h"
+#include "ShaderBatch.h"
+#include "ShaderCache.h"
+#include "FrameData.h"
+#include "GLState.h"
+#include "PipelineWarmup.h"
+#include "VertexStorage.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "TextureManager.h"
+#include "TextureAtlas.h"
+#include "DecodePool.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
@@ -22,12 +35,14 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 }
 
 struct Character {
-	unsigned int TextureID; // ID handle of the glyph texture
+	glm::vec4 UV; // glyph rectangle in the atlas: u0, v0, u1, v1
 	glm::ivec2 Size; // Size of glyph
 	glm::ivec2 Bearing; // Offset from baseline to left/top of glyph
 	unsigned int Advance; // Offset to advance to next glyph
 };
 std::map<char, Character> Characters;
+// every glyph in one texture: a string is a single draw
+std::shared_ptr<Texture> glyphAtlas;
 unsigned int VAO, VBO;
 
 
@@ -35,41 +50,38 @@ void RenderText(Shader& s, std::string text, float x, float y, float scale,	glm:
 {
 	// activate corresponding render state
 	s.use();
-	glUniform3f(glGetUniformLocation(s.getShaderProgramID(), "textColor"),
-		color.x, color.y, color.z);
-	glActiveTexture(GL_TEXTURE0);
-	glBindVertexArray(VAO);
-	// iterate through all characters
+	s.setVec3(s.getUniform("textColor"), color);
+	GLState::activeTexture(GL_TEXTURE0);
+	GLState::bindTexture(GL_TEXTURE_2D, glyphAtlas ? glyphAtlas->ID : 0);
+	GLState::bindVertexArray(VAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
+	// one quad per character, all sampling the glyph atlas
+	std::vector<float> vertices;
+	vertices.reserve(text.size() * 6 * 4);
 	std::string::const_iterator c;
 	for (c = text.begin(); c != text.end(); c++)
 	{
-		Character ch = Characters[*c];
+		const Character& ch = Characters[*c];
 		float xpos = x + ch.Bearing.x * scale;
 		float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
 		float w = ch.Size.x * scale;
 		float h = ch.Size.y * scale;
-		// update VBO for each character
-		float vertices[6][4] = {
-		{ xpos, ypos + h, 0.0f, 0.0f },
-		{ xpos, ypos, 0.0f, 1.0f },
-		{ xpos + w, ypos, 1.0f, 1.0f },
-		{ xpos, ypos + h, 0.0f, 0.0f },
-		{ xpos + w, ypos, 1.0f, 1.0f },
-		{ xpos + w, ypos + h, 1.0f, 0.0f }
+		float quad[6][4] = {
+		{ xpos, ypos + h, ch.UV.x, ch.UV.y },
+		{ xpos, ypos, ch.UV.x, ch.UV.w },
+		{ xpos + w, ypos, ch.UV.z, ch.UV.w },
+		{ xpos, ypos + h, ch.UV.x, ch.UV.y },
+		{ xpos + w, ypos, ch.UV.z, ch.UV.w },
+		{ xpos + w, ypos + h, ch.UV.z, ch.UV.y }
 		};
-		// render glyph texture over quad
-		glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-		// update content of VBO memory
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		// render quad
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		vertices.insert(vertices.end(), &quad[0][0], &quad[0][0] + 6 * 4);
 		// advance cursors for next glyph (advance is 1/64 pixels)
 		x += (ch.Advance >> 6) * scale; // bitshift by 6 (2^6 = 64)
 	}
-	glBindVertexArray(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	// the whole string in one upload (orphaning the previous one) and one draw
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(vertices.size() / 4));
+	// no unbinding: GLState knows what is bound and the next user rebinds as needed
 }
 
 
@@ -108,14 +120,50 @@ int main()
 	// Viewport
 	glViewport(0, 0, 800, 600);
 
-	glEnable(GL_DEPTH_TEST);
+	GLState::enable(GL_DEPTH_TEST);
 
 	// callback de resize
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
 	// Llegim i carreguem a memria els shaders
-	Shader ourShader("res/vertexshader.vs", "res/fragmentshader.fs");
-
+	// (only submitted here: the driver compiles them while we load fonts and textures)
+#ifdef EMBED_SHADERS
+	// shipped builds: res/ is compiled into the binary by tools/embed_shaders
+	ShaderBatch shaders(ShaderFiles::Embedded);
+#else
+	ShaderBatch shaders;
+#endif
+	SpirvModules textModules = { "res/spirv/text.vert.spv", "res/spirv/unlit.frag.spv", { { "textColor", 1 } } };
+	SpirvModules cubeModules = { "res/spirv/cube.vert.spv", "res/spirv/unlit.frag.spv", { { "model", 0 } } };
+#ifdef USE_SPIRV
+	// precompiled SPIR-V (res/spirv) where the driver takes it and the modules
+	// have been built, GLSL otherwise
+	bool spirv = Shader::spirvAvailable(textModules) && Shader::spirvAvailable(cubeModules);
+#else
+	bool spirv = false;
+#endif
+	// text and cube share one fragment shader; TEXT selects the glyph variant
+	// (a #define for GLSL, specialization constant 0 for SPIR-V); the cube uses
+	// cube.opt.vs, where tools/hoist_uniforms moved projection * view * model to
+	// the CPU, or its vertex pulling version on GL 4.3
+	bool pulling = !spirv && VertexStorage::isSupported();
+	Shader& ourShader = spirv ? shaders.add(textModules, { { 0, 1 } }) :
+		shaders.add("res/vertexshader.vs", "res/fragmentshader.fs", { { "TEXT", "1" } });
+	Shader& cubeShader = spirv ? shaders.add(cubeModules) :
+		pulling ? shaders.add("res/cube_pulled.opt.vs", "res/fragmentshader.fs") :
+		shaders.add("res/cube.opt.vs", "res/fragmentshader.fs");
+
+	// camera matrices shared by every program through the FrameData block
+	FrameUniforms frameUniforms;
+
+
+	// every texture goes through the manager: shared, and deleted with its last user;
+	// files are decoded on a worker thread and streamed in by the game loop, and
+	// the workers split each JPEG over the decode pool
+	DecodePool decodePool(std::max(1, (int)std::thread::hardware_concurrency()) - 1);
+	decodePool.install();
+	TextureStreamer textures;
+	TextureManager textureManager(textures);
 
 	FT_Library ft;
 	if (FT_Init_FreeType(&ft))
@@ -133,6 +181,8 @@ int main()
 
 
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // no byte-alignment restriction
+	// every glyph is packed into one single channel atlas page
+	TextureAtlas glyphs(512, 512, 1);
 	for (unsigned char c = 0; c < 128; c++)
 	{
 		// load character glyph
@@ -141,29 +191,17 @@ int main()
 			std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
 			continue;
 		}
-		// generate texture
-		unsigned int texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_RED,
-			face->glyph->bitmap.width,
-			face->glyph->bitmap.rows,
-			0,
-			GL_RED,
-			GL_UNSIGNED_BYTE,
-			face->glyph->bitmap.buffer
-		);
-		// set texture options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		int glyph = glyphs.add(std::to_string(c), face->glyph->bitmap.width, face->glyph->bitmap.rows,
+			face->glyph->bitmap.buffer);
+		if (glyph < 0)
+		{
+			std::cout << "ERROR::FREETYPE: Glyph atlas full" << std::endl;
+			continue;
+		}
+		const AtlasEntry& rect = glyphs.entry(glyph);
 		// now store character for later use
 		Character character = {
-		texture,
+		glm::vec4(rect.u0, rect.v0, rect.u1, rect.v1),
 		glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
 		glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
 		face->glyph->advance.x
@@ -173,28 +211,153 @@ int main()
 
 	FT_Done_Face(face);
 	FT_Done_FreeType(ft);
+	glyphAtlas = textureManager.create("glyphs:fonts/arial.ttf:48", glyphs.width, glyphs.height, glyphs.channels,
+		glyphs.pixels.data(), { GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR, false });
 
 
 
-	//stbi_image_free(data);
-
-
+	// wall texture for the cube (Lesson 8); the cube shows a placeholder until it is resident.
+	// wall.dds is the same image precompressed to BC1 with its mips (tools/texconv)
+	const char* wallPath = GLAD_GL_EXT_texture_compression_s3tc ? "textures/wall.dds" : "textures/wall.jpg";
+	TextureParams wallParams = { GL_REPEAT, GL_LINEAR, GL_LINEAR, true };
+	std::shared_ptr<Texture> wall = textureManager.load(wallPath, wallParams);
+	// the textures go with their last reference, which must happen while the
+	// context exists: every exit from here on calls this before glfwTerminate
+	auto releaseTextures = [&]()
+	{
+		wall.reset();
+		glyphAtlas.reset();
+		textures.shutdown();
+	};
+
+	// cube (Lesson 10): position + texture coordinates
+	float cubeVertices[] = {
+	-0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
+	0.5f, -0.5f, -0.5f, 1.0f, 0.0f,
+	0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+	0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+	-0.5f, 0.5f, -0.5f, 0.0f, 1.0f,
+	-0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
+	-0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+	0.5f, -0.5f, 0.5f, 1.0f, 0.0f,
+	0.5f, 0.5f, 0.5f, 1.0f, 1.0f,
+	0.5f, 0.5f, 0.5f, 1.0f, 1.0f,
+	-0.5f, 0.5f, 0.5f, 0.0f, 1.0f,
+	-0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+	-0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+	-0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+	-0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+	-0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+	-0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+	-0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+	0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+	0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+	0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+	0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+	0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+	0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+	-0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+	0.5f, -0.5f, -0.5f, 1.0f, 1.0f,
+	0.5f, -0.5f, 0.5f, 1.0f, 0.0f,
+	0.5f, -0.5f, 0.5f, 1.0f, 0.0f,
+	-0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+	-0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+	-0.5f, 0.5f, -0.5f, 0.0f, 1.0f,
+	0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+	0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+	0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+	-0.5f, 0.5f, 0.5f, 0.0f, 0.0f,
+	-0.5f, 0.5f, -0.5f, 0.0f, 1.0f
+	};
+
+	unsigned int cubeVAO, cubeVBO;
+	glGenVertexArrays(1, &cubeVAO);
+	glGenBuffers(1, &cubeVBO);
+	GLState::bindVertexArray(cubeVAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	GLState::bindVertexArray(0);
+
+	// the same vertices for vertex pulling: no VAO layout, the shader reads them.
+	// Only made on GL 4.3: before that shader storage buffers are an invalid enum
+	std::optional<VertexStorage> vertexStorage;
+	PulledMesh cubeMesh = { 0, 0 };
+	if (pulling)
+	{
+		vertexStorage.emplace();
+		cubeMesh = vertexStorage->add(cubeVertices, 36, { 5, 0, 3 });
+		vertexStorage->upload();
+	}
 
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLState::bindVertexArray(VAO);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::bindVertexArray(0);
 
 
 
+	// the programs have been compiling since they were added, behind the font
+	// and the buffers; upload the textures decoded meanwhile until they are done
+	while (!shaders.poll())
+	{
+		textures.update();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	bool shadersBuilt = shaders.finish();
+	ShaderCache::printStats();
+	if (!shadersBuilt)
+	{
+		std::cout << "Failed to build the shaders" << std::endl;
+		releaseTextures();
+		glfwTerminate();
+		return -1;
+	}
+
+	// draw every program once with the state the frame uses, so the driver
+	// finishes them now rather than during the first frames. The wall is
+	// still streaming: rather than wait for it (or sample the RGBA8
+	// placeholder) the cube samples a stand-in of the format the wall will
+	// have, BC1 from the .dds and RGB8 from the .jpg, both with full mips
+	unsigned int wallStandIn = PipelineWarmup::standInTexture(
+		GLAD_GL_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_RGB8,
+		GLAD_GL_EXT_texture_compression_s3tc ? 0 : GL_RGB, wallParams);
+	// uniform locations are resolved once, outside the game loop
+	UniformHandle modelLoc = cubeShader.getUniform("model");
+	UniformHandle meshLoc = cubeShader.getUniform("mesh");
+	std::vector<BufferBinding> cubeBuffers;
+	if (pulling)
+	{
+		// the pulled cube reads its vertices from the storage buffers, at the
+		// mesh the frame draws
+		cubeBuffers = vertexStorage->bindings();
+		cubeShader.use();
+		cubeShader.setInt(meshLoc, cubeMesh.index);
+	}
+	DrawState cubeState = { true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, true, GL_LESS, true };
+	DrawState textState = { true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, false, GL_LESS, true };
+	PipelineWarmup warmup;
+	warmup.add("cube", cubeShader.ID, pulling ? vertexStorage->vao : cubeVAO, wallStandIn, cubeState, cubeBuffers);
+	warmup.add("text", ourShader.ID, VAO, glyphAtlas->ID, textState);
+	warmup.run();
+	GLState::forgetTexture(wallStandIn);
+	glDeleteTextures(1, &wallStandIn);
+	// the loop only turns depth testing back on after the text
+	GLState::enable(GL_DEPTH_TEST);
+
 	ourShader.use();
 
+	FrameData frame;
 
+	double lastReport = glfwGetTime();
 
 	// Game Loop
 	while (!glfwWindowShouldClose(window))
@@ -202,16 +365,16 @@ int main()
 		// inputs
 		processInput(window);
 
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		// textures finished decoding since the last frame, within the upload budget
+		textures.update();
+
+		GLState::enable(GL_BLEND);
+		GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 		// rendering Commands
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		//glBindTexture(GL_TEXTURE_2D, texture);
-		glBindVertexArray(VAO);
-
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::rotate(model, glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 
@@ -222,34 +385,70 @@ int main()
 		float camZ = static_cast<float>(cos(glfwGetTime()) * radius);
 		view = glm::lookAt(glm::vec3(camX, 0.0f, camZ), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-		//glm::mat4 projection;
-		//projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
-		glm::mat4 projection = glm::ortho(0.0f, 800.0f, 0.0f, 600.0f);
-
-		int modelLoc = glGetUniformLocation(ourShader.ID, "model");
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-		int viewlLoc = glGetUniformLocation(ourShader.ID, "view");
-		glUniformMatrix4fv(viewlLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-		int projectionLoc = glGetUniformLocation(ourShader.ID, "projection");
-		glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-
-		ourShader.use();
+		// one upload per frame, whatever the number of programs
+		frame.view = view;
+		frame.projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+		frame.screen = glm::ortho(0.0f, 800.0f, 0.0f, 600.0f);
+		frameUniforms.update(frame);
+
+		// render the cube
+		cubeShader.use();
+		cubeShader.setMat4(modelLoc, model);
+		// projection_view_model, computed once the model matrix is known
+		cubeShader.flush();
+		GLState::activeTexture(GL_TEXTURE0);
+		GLState::bindTexture(GL_TEXTURE_2D, wall->ID);
+		if (pulling)
+		{
+			vertexStorage->bind();
+			cubeShader.setInt(meshLoc, cubeMesh.index);
+			glDrawArrays(GL_TRIANGLES, 0, cubeMesh.vertexCount);
+		}
+		else
+		{
+			GLState::bindVertexArray(cubeVAO);
+			glDrawArrays(GL_TRIANGLES, 0, 36);
+		}
 
-		//render text
+		//render text on top of the scene
+		GLState::disable(GL_DEPTH_TEST);
 		RenderText(ourShader, "This is sample text", 25.0f, 25.0f, 1.0f,
 			glm::vec3(0.5, 0.8f, 0.2f));
 		RenderText(ourShader, "(C) LearnOpenGL.com", 540.0f, 570.0f, 0.5f,
 			glm::vec3(0.3, 0.7f, 0.9f));
+		GLState::enable(GL_DEPTH_TEST);
 
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+
+		// per-frame counters, printed once per second
+		if (glfwGetTime() - lastReport >= 1.0)
+		{
+			std::cout << "FRAME::UNIFORMS issued: " << Shader::frameStats.issued <<
+				" elided: " << Shader::frameStats.elided << std::endl;
+			std::cout << "FRAME::GLSTATE issued: " << GLState::frameStats.issued <<
+				" suppressed: " << GLState::frameStats.suppressed << std::endl;
+			lastReport = glfwGetTime();
+		}
+		Shader::resetFrameStats();
+		GLState::resetFrameStats();
 	}
 
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	glDeleteVertexArrays(1, &cubeVAO);
+	glDeleteBuffers(1, &cubeVBO);
+	textureManager.report();
+	textures.report();
+	TextureCache::printStats();
+	releaseTextures();
+	glDeleteBuffers(1, &frameUniforms.ID);
+	if (vertexStorage)
+	{
+		glDeleteVertexArrays(1, &vertexStorage->vao);
+		glDeleteBuffers(1, &vertexStorage->vertexBuffer);
+		glDeleteBuffers(1, &vertexStorage->meshBuffer);
+	}
 	
 	// Lliberar recursos
 	glfwTerminate();
@@ -0,0 +1,25 @@
+// Generated by tools/hoist_uniforms.cpp from res/ - do not edit.
+#pragma once
+
+#ifndef HOISTEDUNIFORMS_H
+#define HOISTEDUNIFORMS_H
+
+#include <string_view>
+
+// a mat4 uniform of an optimized shader standing for the product of other
+// uniforms; operands in a block are "Block.member"
+struct HoistedUniform
+{
+	std::string_view shader;
+	std::string_view name;
+	std::string_view operands[4];
+	int operandCount;
+};
+
+inline constexpr int hoistedUniformCount = 2;
+inline constexpr HoistedUniform hoistedUniforms[] = {
+	{ "res/cube.opt.vs", "projection_view_model", { "FrameData.projection", "FrameData.view", "model" }, 3 },
+	{ "res/cube_pulled.opt.vs", "projection_view_model", { "FrameData.projection", "FrameData.view", "model" }, 3 },
+};
+
+#endif
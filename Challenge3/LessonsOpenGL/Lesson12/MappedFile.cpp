@@ -0,0 +1,204 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	std::string systemError()
+	{
+#ifdef _WIN32
+		char message[256] = "";
+		FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, GetLastError(),
+			0, message, sizeof(message), NULL);
+		std::string text(message);
+		while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+			text.pop_back();
+		return text;
+#else
+		return strerror(errno);
+#endif
+	}
+}
+
+MappedDirectory::MappedDirectory()
+	: fd(-1)
+{
+}
+
+MappedDirectory::~MappedDirectory()
+{
+#ifndef _WIN32
+	if (fd >= 0)
+		::close(fd);
+#endif
+}
+
+bool MappedDirectory::open(const std::string& path)
+{
+	directoryPath = path.empty() ? "." : path;
+#ifdef _WIN32
+	// no openat on Windows: files are opened by full path
+	DWORD attributes = GetFileAttributesA(directoryPath.c_str());
+	if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+	{
+		errorMessage = directoryPath + ": " + systemError();
+		return false;
+	}
+	fd = 0;
+#else
+	fd = ::open(directoryPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		errorMessage = directoryPath + ": " + systemError();
+		return false;
+	}
+#endif
+	return true;
+}
+
+MappedFile::MappedFile()
+	: mapping(nullptr), length(0)
+#ifdef _WIN32
+	, fileMapping(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		errorMessage = path + ": " + systemError();
+		return false;
+	}
+	bool ok = mapHandle(path, (long long)file);
+	CloseHandle(file);
+	return ok;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		errorMessage = path + ": " + systemError();
+		return false;
+	}
+	bool ok = mapHandle(path, fd);
+	::close(fd);
+	return ok;
+#endif
+}
+
+bool MappedFile::open(const MappedDirectory& directory, const std::string& name)
+{
+#ifdef _WIN32
+	return open(directory.path() + "/" + name);
+#else
+	close();
+	std::string path = directory.path() + "/" + name;
+	if (directory.fd < 0)
+	{
+		errorMessage = path + ": directory not open";
+		return false;
+	}
+	int fd = ::openat(directory.fd, name.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		errorMessage = path + ": " + systemError();
+		return false;
+	}
+	bool ok = mapHandle(path, fd);
+	::close(fd);
+	return ok;
+#endif
+}
+
+bool MappedFile::mapHandle(const std::string& path, long long handle)
+{
+#ifdef _WIN32
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx((HANDLE)handle, &fileSize))
+	{
+		errorMessage = path + ": " + systemError();
+		return false;
+	}
+	length = (size_t)fileSize.QuadPart;
+	// empty files cannot be mapped, but they are valid (empty) content
+	if (length == 0)
+		return true;
+	fileMapping = CreateFileMappingA((HANDLE)handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (fileMapping == NULL)
+	{
+		errorMessage = path + ": " + systemError();
+		length = 0;
+		return false;
+	}
+	mapping = static_cast<const char*>(MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	struct stat info;
+	if (fstat((int)handle, &info) != 0)
+	{
+		errorMessage = path + ": " + systemError();
+		return false;
+	}
+	length = (size_t)info.st_size;
+	// empty files cannot be mapped, but they are valid (empty) content
+	if (length == 0)
+		return true;
+	void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, (int)handle, 0);
+	mapping = address == MAP_FAILED ? nullptr : static_cast<const char*>(address);
+#endif
+	if (mapping == nullptr)
+	{
+		errorMessage = path + ": " + systemError();
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::adviseSequential() const
+{
+#ifndef _WIN32
+	if (!mapping)
+		return;
+	// only hints: the mapping works the same if they fail
+	void* address = const_cast<char*>(mapping);
+	madvise(address, length, MADV_SEQUENTIAL);
+	madvise(address, length, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (mapping)
+		UnmapViewOfFile(mapping);
+	if (fileMapping)
+		CloseHandle(fileMapping);
+	fileMapping = NULL;
+#else
+	if (mapping)
+		munmap(const_cast<char*>(mapping), length);
+#endif
+	mapping = nullptr;
+	length = 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+
+// An open directory that files can be opened relative to (openat on POSIX),
+// so a batch of files from one directory costs a single directory lookup.
+class MappedDirectory
+{
+public:
+	MappedDirectory();
+	~MappedDirectory();
+	MappedDirectory(const MappedDirectory&) = delete;
+	MappedDirectory& operator=(const MappedDirectory&) = delete;
+
+	// false with error() set if the directory cannot be opened
+	bool open(const std::string& path);
+	const std::string& path() const { return directoryPath; }
+	const std::string& error() const { return errorMessage; }
+
+private:
+	friend class MappedFile;
+	std::string directoryPath;
+	std::string errorMessage;
+	int fd;
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// false with error() set (path and system message) if the file cannot be mapped
+	bool open(const std::string& path);
+	bool open(const MappedDirectory& directory, const std::string& name);
+	void close();
+	// the file will be read once, front to back: read ahead more, let pages go
+	// once read, and start reading it in now (madvise; on Windows files are
+	// opened for sequential scan already)
+	void adviseSequential() const;
+
+	const char* data() const { return mapping; }
+	size_t size() const { return length; }
+	std::string_view view() const { return std::string_view(mapping, length); }
+	const std::string& error() const { return errorMessage; }
+
+private:
+	const char* mapping;
+	size_t length;
+	std::string errorMessage;
+#ifdef _WIN32
+	void* fileMapping;
+#endif
+
+	bool mapHandle(const std::string& path, long long handle);
+};
+#endif
@@ -0,0 +1,161 @@
+#include "MipChain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPCHAIN_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// 8-bit sRGB -> linear, and the midpoints between consecutive codes for the
+	// way back, with a coarse table to start searching them from
+	struct SrgbTables
+	{
+		float toLinear[256];
+		float midpoints[255];
+		unsigned char coarse[1024];
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				double c = i / 255.0;
+				toLinear[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+			}
+			for (int i = 0; i < 255; i++)
+				midpoints[i] = (toLinear[i] + toLinear[i + 1]) * 0.5f;
+			for (int i = 0; i < 1024; i++)
+				coarse[i] = (unsigned char)(std::upper_bound(midpoints, midpoints + 255, i / 1024.0f) - midpoints);
+		}
+	};
+	const SrgbTables srgb;
+
+	// nearest 8-bit sRGB code of a linear value: the code at the start of its
+	// 1/1024 bucket, moved up past the midpoints below the value
+	unsigned char encodeSrgb(float value)
+	{
+		int bucket = std::min(std::max((int)(value * 1024.0f), 0), 1023);
+		int code = srgb.coarse[bucket];
+		while (code < 255 && srgb.midpoints[code] <= value)
+			code++;
+		return (unsigned char)code;
+	}
+
+	// one row as 4 floats per texel (missing channels are 0)
+	void expandRow(const unsigned char* row, int width, int channels, bool gamma, float* out)
+	{
+		for (int x = 0; x < width; x++, row += channels, out += 4)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				if (c >= channels)
+					out[c] = 0.0f;
+				else if (gamma && c < 3)
+					out[c] = srgb.toLinear[row[c]];
+				else
+					out[c] = row[c] * (1.0f / 255.0f);
+			}
+		}
+	}
+
+	void downsample(const unsigned char* source, int sourceWidth, int sourceHeight, int channels,
+		unsigned char* out, int width, int height, std::vector<float>& scratch)
+	{
+		bool gamma = channels >= 3;
+		size_t sourceRow = (size_t)sourceWidth * channels;
+		scratch.resize((size_t)sourceWidth * 4 * 2 + (size_t)width * 4);
+		float* top = scratch.data();
+		float* bottom = top + (size_t)sourceWidth * 4;
+		float* averaged = bottom + (size_t)sourceWidth * 4;
+
+		for (int y = 0; y < height; y++)
+		{
+			int y0 = std::min(2 * y, sourceHeight - 1), y1 = std::min(2 * y + 1, sourceHeight - 1);
+			expandRow(source + y0 * sourceRow, sourceWidth, channels, gamma, top);
+			expandRow(source + y1 * sourceRow, sourceWidth, channels, gamma, bottom);
+
+			// (top left + bottom left) + (top right + bottom right), in that order on both paths
+			for (int x = 0; x < width; x++)
+			{
+				int x0 = std::min(2 * x, sourceWidth - 1), x1 = std::min(2 * x + 1, sourceWidth - 1);
+#ifdef MIPCHAIN_SSE2
+				__m128 left = _mm_add_ps(_mm_loadu_ps(top + 4 * x0), _mm_loadu_ps(bottom + 4 * x0));
+				__m128 right = _mm_add_ps(_mm_loadu_ps(top + 4 * x1), _mm_loadu_ps(bottom + 4 * x1));
+				_mm_storeu_ps(averaged + 4 * x, _mm_mul_ps(_mm_add_ps(left, right), _mm_set1_ps(0.25f)));
+#else
+				for (int c = 0; c < 4; c++)
+				{
+					float left = top[4 * x0 + c] + bottom[4 * x0 + c];
+					float right = top[4 * x1 + c] + bottom[4 * x1 + c];
+					averaged[4 * x + c] = (left + right) * 0.25f;
+				}
+#endif
+			}
+
+			unsigned char* row = out + (size_t)y * width * channels;
+			for (int x = 0; x < width; x++)
+			{
+				const float* texel = averaged + 4 * x;
+				int linear[4];
+#ifdef MIPCHAIN_SSE2
+				// round to nearest even, like lrint
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(linear), _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(texel), _mm_set1_ps(255.0f))));
+#else
+				for (int c = 0; c < 4; c++)
+					linear[c] = (int)std::lrint(texel[c] * 255.0f);
+#endif
+				for (int c = 0; c < channels; c++)
+				{
+					if (gamma && c < 3)
+						row[x * channels + c] = encodeSrgb(texel[c]);
+					else
+						row[x * channels + c] = (unsigned char)std::min(std::max(linear[c], 0), 255);
+				}
+			}
+		}
+	}
+}
+
+int MipChain::levelCount(int width, int height)
+{
+	int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		levels++;
+	}
+	return levels;
+}
+
+void MipChain::build(const unsigned char* image, int width, int height, int channels)
+{
+	auto start = std::chrono::steady_clock::now();
+	levels.clear();
+	size_t total = 0;
+	for (int w = width, h = height; w > 1 || h > 1; )
+	{
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+		levels.push_back({ w, h, total });
+		total += (size_t)w * h * channels;
+	}
+	pixels.resize(total);
+
+	std::vector<float> scratch;
+	const unsigned char* source = image;
+	int sourceWidth = width, sourceHeight = height;
+	for (const MipLevel& level : levels)
+	{
+		unsigned char* out = pixels.data() + level.offset;
+		downsample(source, sourceWidth, sourceHeight, channels, out, level.width, level.height, scratch);
+		source = out;
+		sourceWidth = level.width;
+		sourceHeight = level.height;
+	}
+	milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef MIPCHAIN_H
+#define MIPCHAIN_H
+
+#include <cstddef>
+#include <vector>
+
+// one level below the image: a slice of MipChain::pixels
+struct MipLevel
+{
+	int width;
+	int height;
+	size_t offset;
+};
+
+// The mip levels of an 8-bit image, built on the CPU so textures can be
+// uploaded into immutable storage level by level instead of asking the driver
+// for glGenerateMipmap. Each level is a 2x2 box filter of the one above (odd
+// sizes repeat their last row/column), averaged in linear light: RGB of 3 and
+// 4 channel images is taken as sRGB-encoded, alpha and 1-2 channel images
+// (glyphs, data) as linear. The result only depends on the input, so it is
+// the same on every run; the SSE2 and plain C++ paths give the same bytes.
+class MipChain
+{
+public:
+	// levels 1 to n (1x1); level 0 is the image itself, which is not copied
+	std::vector<MipLevel> levels;
+	std::vector<unsigned char> pixels;
+	// time build() took
+	double milliseconds = 0.0;
+
+	// builds every level below a tightly packed image
+	void build(const unsigned char* image, int width, int height, int channels);
+	const unsigned char* levelData(size_t level) const { return pixels.data() + levels[level].offset; }
+	// levels of a full chain, the image included
+	static int levelCount(int width, int height);
+};
+#endif
@@ -0,0 +1,117 @@
+#include "PipelineWarmup.h"
+#include "GLState.h"
+
+#include <glad/glad.h>
+#include <chrono>
+#include <iostream>
+
+unsigned int PipelineWarmup::standInTexture(unsigned int internalFormat, unsigned int format, const TextureParams& params)
+{
+	const int size = 4;
+	int levels = params.mipmaps ? 3 : 1;
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	GLState::bindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+	bool immutable = Texture::allocate(internalFormat, format, levels, size, size);
+
+	// black texels; big enough for a 4x4 level of any format, rows padded to 4 bytes
+	const unsigned char zeros[size * size * 4] = {};
+	// BC1 and BC4 take 8 bytes per 4x4 block, the other block formats 16
+	int blockBytes = internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RED_RGTC1 ? 8 : 16;
+	for (int level = 0, levelSize = size; level < levels; level++, levelSize /= 2)
+	{
+		if (format != 0)
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelSize, levelSize, format, GL_UNSIGNED_BYTE, zeros);
+		else if (immutable)
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelSize, levelSize, internalFormat, blockBytes, zeros);
+		else
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelSize, levelSize, 0, blockBytes, zeros);
+	}
+	return texture;
+}
+
+void PipelineWarmup::add(const std::string& label, unsigned int program, unsigned int vao, unsigned int texture, const DrawState& state,
+	const std::vector<BufferBinding>& buffers)
+{
+	Draw draw;
+	draw.label = label;
+	draw.program = program;
+	draw.vao = vao;
+	draw.texture = texture;
+	draw.state = state;
+	draw.buffers = buffers;
+	draws.push_back(draw);
+}
+
+double PipelineWarmup::run()
+{
+	// 1x1 target with the formats of the default framebuffer, since drivers
+	// may key their variants on them too
+	unsigned int fbo, color, depth;
+	glGenFramebuffers(1, &fbo);
+	glGenRenderbuffers(1, &color);
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 1, 1);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::PIPELINE::WARMUP::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glViewport(0, 0, 1, 1);
+	// nothing queued before the warm-up is counted in the first draw
+	glFinish();
+
+	double totalMs = 0.0;
+	for (const Draw& draw : draws)
+	{
+		auto start = std::chrono::steady_clock::now();
+		GLState::useProgram(draw.program);
+		GLState::bindVertexArray(draw.vao);
+		for (const BufferBinding& binding : draw.buffers)
+			GLState::bindBufferBase(binding.target, binding.index, binding.buffer);
+		GLState::activeTexture(GL_TEXTURE0);
+		GLState::bindTexture(GL_TEXTURE_2D, draw.texture);
+		if (draw.state.blend)
+		{
+			GLState::enable(GL_BLEND);
+			GLState::blendFunc(draw.state.blendSrc, draw.state.blendDst);
+		}
+		else
+			GLState::disable(GL_BLEND);
+		if (draw.state.depthTest)
+		{
+			GLState::enable(GL_DEPTH_TEST);
+			GLState::depthFunc(draw.state.depthFunc);
+		}
+		else
+			GLState::disable(GL_DEPTH_TEST);
+		GLState::depthMask(draw.state.depthMask);
+
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		// wait for it, so whatever the driver does on first use is in this draw's time
+		glFinish();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		totalMs += ms;
+		std::cout << "PIPELINE::WARMUP " << draw.label << ": " << ms << " ms" << std::endl;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &color);
+	glDeleteRenderbuffers(1, &depth);
+
+	std::cout << "PIPELINE::WARMUP " << draws.size() << " draws in " << totalMs << " ms" << std::endl;
+	return totalMs;
+}
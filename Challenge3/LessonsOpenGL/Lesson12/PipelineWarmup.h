@@ -0,0 +1,57 @@
+#pragma once
+
+#ifndef PIPELINEWARMUP_H
+#define PIPELINEWARMUP_H
+
+#include "GLState.h"
+#include "Texture.h"
+
+#include <string>
+#include <vector>
+
+// blend/depth state a draw is issued with
+struct DrawState
+{
+	bool blend;
+	unsigned int blendSrc;
+	unsigned int blendDst;
+	bool depthTest;
+	unsigned int depthFunc;
+	bool depthMask;
+};
+
+// Drivers often finish a program, or recompile it for the state it is drawn
+// with, on its first draw. The warm-up draws every combination the frame uses
+// once, into a 1x1 offscreen target during loading, and logs how long each
+// one took, so the hitch shows up there instead of in the first frames.
+class PipelineWarmup
+{
+public:
+	// registers a program drawn from vao (its buffers must hold at least 3
+	// vertices) with texture bound on unit 0 (0 for none) and the given state.
+	// buffers are the indexed bindings the frame makes for the draw (shader
+	// storage read by vertex pulling); uniforms are left as the program has them
+	void add(const std::string& label, unsigned int program, unsigned int vao, unsigned int texture, const DrawState& state,
+		const std::vector<BufferBinding>& buffers = std::vector<BufferBinding>());
+	// draws each combination, waiting for the GPU after each; returns the total in ms
+	double run();
+	// a 4x4 texture to warm up with before the one the frame samples is
+	// resident: same internal format (format 0 for a compressed one) and, with
+	// mipmaps, a full chain like it. Sampling state is part of what drivers key
+	// on, not the texels. Delete it (and forget it in GLState) after run()
+	static unsigned int standInTexture(unsigned int internalFormat, unsigned int format, const TextureParams& params);
+	size_t size() const { return draws.size(); }
+
+private:
+	struct Draw
+	{
+		std::string label;
+		unsigned int program;
+		unsigned int vao;
+		unsigned int texture;
+		DrawState state;
+		std::vector<BufferBinding> buffers;
+	};
+	std::vector<Draw> draws;
+};
+#endif
@@ -0,0 +1,76 @@
+#include "ProgramPipeline.h"
+#include "GLState.h"
+
+#include <glad/glad.h>
+#include <iostream>
+
+ProgramPipeline::ProgramPipeline(const ShaderStage& vertex, const ShaderStage& fragment)
+	: ID(0), valid(vertex.isValid() && fragment.isValid())
+{
+	if (!valid)
+	{
+		std::cout << "ERROR::PIPELINE::STAGE_NOT_VALID " << vertex.getPath() << " " << fragment.getPath() << std::endl;
+		return;
+	}
+
+	// a mismatch is not a link error anymore: the driver would just read undefined values
+	valid = matchInterfaces(vertex, fragment);
+
+	glGenProgramPipelines(1, &ID);
+	glUseProgramStages(ID, GL_VERTEX_SHADER_BIT, vertex.ID);
+	glUseProgramStages(ID, GL_FRAGMENT_SHADER_BIT, fragment.ID);
+
+	int success;
+	glValidateProgramPipeline(ID);
+	glGetProgramPipelineiv(ID, GL_VALIDATE_STATUS, &success);
+	if (!success)
+	{
+		int length = 0;
+		glGetProgramPipelineiv(ID, GL_INFO_LOG_LENGTH, &length);
+		std::string infoLog(length > 0 ? length : 1, '\0');
+		glGetProgramPipelineInfoLog(ID, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+		std::cout << "ERROR::PIPELINE::VALIDATION_FAILED " << vertex.getPath() << " " << fragment.getPath() <<
+			"\n" << infoLog.c_str() << std::endl;
+		valid = false;
+	}
+}
+
+bool ProgramPipeline::matchInterfaces(const ShaderStage& producer, const ShaderStage& consumer)
+{
+	bool matched = true;
+	for (const StageVariable& input : consumer.getInputs())
+	{
+		// variables with explicit locations match by location, the rest by name
+		const StageVariable* output = nullptr;
+		for (const StageVariable& candidate : producer.getOutputs())
+		{
+			bool same = input.location >= 0 && candidate.location >= 0 ?
+				input.location == candidate.location : input.name == candidate.name;
+			if (same)
+			{
+				output = &candidate;
+				break;
+			}
+		}
+
+		if (!output)
+		{
+			std::cout << "ERROR::PIPELINE::INTERFACE_MISMATCH " << consumer.getPath() << " reads " << input.name <<
+				", which " << producer.getPath() << " does not write" << std::endl;
+			matched = false;
+		}
+		else if (output->type != input.type || output->arraySize != input.arraySize)
+		{
+			std::cout << "ERROR::PIPELINE::INTERFACE_MISMATCH " << input.name << " has a different type in " <<
+				producer.getPath() << " and " << consumer.getPath() << std::endl;
+			matched = false;
+		}
+	}
+	return matched;
+}
+
+void ProgramPipeline::use()
+{
+	GLState::useProgram(0);
+	GLState::bindProgramPipeline(ID);
+}
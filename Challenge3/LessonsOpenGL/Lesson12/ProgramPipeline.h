@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef PROGRAMPIPELINE_H
+#define PROGRAMPIPELINE_H
+
+#include "ShaderStage.h"
+
+// A program pipeline object combining separately linked stages. Building one
+// costs no compile or link, so N vertex stages and M fragment stages cost N+M
+// compiles instead of N*M programs.
+class ProgramPipeline
+{
+public:
+	// the pipeline ID
+	unsigned int ID;
+	// checks that the fragment inputs are all written by the vertex stage, then
+	// validates the pipeline; errors are printed and leave it not valid
+	ProgramPipeline(const ShaderStage& vertex, const ShaderStage& fragment);
+	bool isValid() const { return valid; }
+	// binds the pipeline (and unbinds any program, which would take precedence)
+	void use();
+
+private:
+	bool valid;
+
+	static bool matchInterfaces(const ShaderStage& producer, const ShaderStage& consumer);
+};
+#endif
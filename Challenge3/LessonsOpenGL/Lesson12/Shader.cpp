@@ -1,108 +1,575 @@
 #include "Shader.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "FrameData.h"
+#include "GLState.h"
+#include "EmbeddedShaders.h"
+#include "HoistedUniforms.h"
+#include "MappedFile.h"
 
 #include <glad/glad.h> // include glad to get the required OpenGL headers
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
-{
-	// 1. retrieve the vertex/fragment source code from filePath
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	// ensure ifstream objects can throw exceptions:
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try
-	{
-		// open files
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
-		// read files buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		// close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		// convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	}
-	catch (std::ifstream::failure e)
-	{
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-	}
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
-
-	// 2. compile shaders
-	unsigned int vertex, fragment;
-	int success;
-	char infoLog[512];
-	
-	// vertex Shader
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vShaderCode, NULL);
-	glCompileShader(vertex);
-	// print compile errors if any
-	glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" <<
-			infoLog << std::endl;
-	};
-
-	// fragment Shader
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderCode, NULL);
-	glCompileShader(fragment);
-	// print compile errors if any
-	glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" <<
-			infoLog << std::endl;
-	};
-
-	// shader Program
+#include <glm/gtc/type_ptr.hpp>
+
+namespace
+{
+	// 32-bit FNV-1a of a uniform name, compared before the name itself
+	unsigned int hashName(const char* name)
+	{
+		unsigned int hash = 2166136261u;
+		for (; *name; name++)
+		{
+			hash ^= (unsigned char)*name;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// maps a SPIR-V module, checking it at least looks like one
+	bool mapSpirvModule(MappedFile& module, const char* path)
+	{
+		if (!module.open(path))
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << module.error() << std::endl;
+			return false;
+		}
+		uint32_t magic = 0;
+		if (module.size() >= 20 && module.size() % 4 == 0)
+			memcpy(&magic, module.data(), sizeof(magic));
+		if (magic != 0x07230203u)
+		{
+			std::cout << "ERROR::SHADER::SPIRV::NOT_A_MODULE " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// the entry point is glSpecializeShader from GL 4.6 on, and the _ARB one
+	// where only the extension is there
+	void specializeShader(unsigned int shader, const std::vector<unsigned int>& ids, const std::vector<unsigned int>& values)
+	{
+		if (GLAD_GL_VERSION_4_6)
+			glSpecializeShader(shader, "main", (GLuint)ids.size(), ids.data(), values.data());
+		else
+			glSpecializeShaderARB(shader, "main", (GLuint)ids.size(), ids.data(), values.data());
+	}
+
+	// keeps the constants a module declares (OpDecorate ... SpecId n): the
+	// driver fails the specialization on ids the stage does not have
+	void moduleConstants(std::string_view module, const SpecializationConstants& constants,
+		std::vector<unsigned int>& ids, std::vector<unsigned int>& values)
+	{
+		const uint32_t opDecorate = 71, decorationSpecId = 1;
+		std::vector<uint32_t> words(module.size() / 4);
+		memcpy(words.data(), module.data(), words.size() * 4);
+		// the header is 5 words; each instruction starts with (word count << 16) | opcode
+		for (size_t i = 5; i < words.size();)
+		{
+			uint32_t count = words[i] >> 16, opcode = words[i] & 0xFFFFu;
+			if (count == 0 || i + count > words.size())
+				break;
+			if (opcode == opDecorate && count >= 4 && words[i + 2] == decorationSpecId)
+			{
+				for (const SpecializationConstant& constant : constants)
+				{
+					if (constant.id == words[i + 3])
+					{
+						ids.push_back(constant.id);
+						values.push_back(constant.value);
+					}
+				}
+			}
+			i += count;
+		}
+	}
+
+	// bytes needed to shadow one element of a uniform of the given type
+	unsigned int uniformTypeSize(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2:
+			return 8;
+		case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3:
+			return 12;
+		case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4:
+		case GL_FLOAT_MAT2:
+			return 16;
+		case GL_FLOAT_MAT3:
+			return 36;
+		case GL_FLOAT_MAT4:
+			return 64;
+		default:
+			// scalars and samplers
+			return 4;
+		}
+	}
+}
+
+UniformStats Shader::frameStats;
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, bool deferred)
+	: Shader(vertexPath, fragmentPath, ShaderDefines(), deferred)
+{
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, bool deferred)
+	: pendingVertex(0), pendingFragment(0), ready(false), valid(true), spirv(false)
+{
+	ShaderFiles files;
+	build(vertexPath, fragmentPath, defines, files, deferred);
+}
+
+Shader::Shader(const EmbeddedShader& vertex, const EmbeddedShader& fragment, const ShaderDefines& defines)
+	: pendingVertex(0), pendingFragment(0), ready(false), valid(true), spirv(false)
+{
+	ShaderFiles files(ShaderFiles::Embedded);
+	build(std::string(vertex.path).c_str(), std::string(fragment.path).c_str(), defines, files, false);
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, ShaderFiles& files, bool deferred)
+	: pendingVertex(0), pendingFragment(0), ready(false), valid(true), spirv(false)
+{
+	build(vertexPath, fragmentPath, defines, files, deferred);
+}
+
+Shader::Shader(const SpirvModules& modules, const SpecializationConstants& constants, bool deferred)
+	: pendingVertex(0), pendingFragment(0), ready(false), valid(true), spirv(true)
+{
+	buildSpirv(modules, constants, deferred);
+}
+
+void Shader::build(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, ShaderFiles& files, bool deferred)
+{
+	// 1. map the vertex/fragment source code from filePath, with the
+	// includes resolved and the variant's defines injected
+	ShaderPreprocessor vertexSource, fragmentSource;
+	bool read = vertexSource.process(files, vertexPath, defines);
+	read = fragmentSource.process(files, fragmentPath, defines) && read;
+	vertexFiles = vertexSource.files();
+	fragmentFiles = fragmentSource.files();
+	if (!read)
+	{
+		// the errors are already printed; compiling a partial source would only add noise
+		std::cout << "ERROR::SHADER::PROGRAM::NOT_BUILT " << vertexPath << " " << fragmentPath << std::endl;
+		ID = 0;
+		valid = false;
+		ready = true;
+		return;
+	}
+
+	// 2. reuse the linked program from the binary cache when possible
 	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
-	glLinkProgram(ID);
-	// print linking errors if any
-	glGetProgramiv(ID, GL_LINK_STATUS, &success);
-	if (!success)
+	cacheKey = ShaderCache::makeKey(vertexSource.segments(), fragmentSource.segments());
+	if (!ShaderCache::load(ID, cacheKey))
+		submit(vertexSource.segments(), fragmentSource.segments());
+
+	// deferred shaders are finished later, by whoever batched them
+	if (!deferred)
+		finish();
+}
+
+void Shader::submit(const std::vector<std::string_view>& vertexCode, const std::vector<std::string_view>& fragmentCode)
+{
+	// 3. compile and link without asking for any status: a status query
+	// makes the driver finish the work, so it would serialize everything
+	pendingVertex = ShaderCompiler::submitStage(GL_VERTEX_SHADER, vertexCode);
+	pendingFragment = ShaderCompiler::submitStage(GL_FRAGMENT_SHADER, fragmentCode);
+	glAttachShader(ID, pendingVertex);
+	glAttachShader(ID, pendingFragment);
+	ShaderCompiler::submitLink(ID);
+}
+
+void Shader::buildSpirv(const SpirvModules& modules, const SpecializationConstants& constants, bool deferred)
+{
+	vertexFiles.assign(1, modules.vertexPath);
+	fragmentFiles.assign(1, modules.fragmentPath);
+	uniformLocations = modules.uniformLocations;
+
+	// 1. map both modules; glShaderBinary copies them, so the mappings end here
+	MappedFile vertexModule, fragmentModule;
+	bool read = spirvSupported();
+	if (!read)
+		std::cout << "ERROR::SHADER::SPIRV::NOT_SUPPORTED (needs GL 4.6 or GL_ARB_gl_spirv)" << std::endl;
+	else
 	{
-		glGetProgramInfoLog(ID, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" <<
-			infoLog << std::endl;
+		read = mapSpirvModule(vertexModule, modules.vertexPath);
+		read = mapSpirvModule(fragmentModule, modules.fragmentPath) && read;
 	}
+	if (!read)
+	{
+		std::cout << "ERROR::SHADER::PROGRAM::NOT_BUILT " << modules.vertexPath << " " << modules.fragmentPath << std::endl;
+		ID = 0;
+		valid = false;
+		ready = true;
+		return;
+	}
+
+	// 2. the binary cache applies as well, keyed by the modules and the constants
+	std::string constantsKey = specializationKey(constants);
+	ID = glCreateProgram();
+	cacheKey = ShaderCache::makeKey({ vertexModule.view(), constantsKey }, { fragmentModule.view(), constantsKey });
+	if (!ShaderCache::load(ID, cacheKey))
+		submitSpirv(vertexModule.view(), fragmentModule.view(), constants);
+
+	if (!deferred)
+		finish();
+}
+
+void Shader::submitSpirv(std::string_view vertexModule, std::string_view fragmentModule, const SpecializationConstants& constants)
+{
+	// 3. specializing is what compiling is for GLSL, and it is left running the same way
+	std::vector<unsigned int> ids, values;
+	pendingVertex = glCreateShader(GL_VERTEX_SHADER);
+	glShaderBinary(1, &pendingVertex, GL_SHADER_BINARY_FORMAT_SPIR_V, vertexModule.data(), (GLsizei)vertexModule.size());
+	moduleConstants(vertexModule, constants, ids, values);
+	specializeShader(pendingVertex, ids, values);
+
+	ids.clear();
+	values.clear();
+	pendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderBinary(1, &pendingFragment, GL_SHADER_BINARY_FORMAT_SPIR_V, fragmentModule.data(), (GLsizei)fragmentModule.size());
+	moduleConstants(fragmentModule, constants, ids, values);
+	specializeShader(pendingFragment, ids, values);
+
+	glAttachShader(ID, pendingVertex);
+	glAttachShader(ID, pendingFragment);
+	ShaderCompiler::submitLink(ID);
+}
+
+bool Shader::isReady() const
+{
+	if (ready || pendingVertex == 0)
+		return true;
+	// without the extension there is no way to ask, finish() will simply wait
+	if (!parallelCompileSupported())
+		return true;
+	int completed = 0;
+	glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed != 0;
+}
+
+void Shader::finish()
+{
+	if (ready)
+		return;
+	ready = true;
+
+	if (pendingVertex != 0)
+		checkCompileAndLink();
+
+	// 4. hook up the shared uniform blocks and resolve every active uniform once
+	ShaderCompiler::bindUniformBlocks(ID);
+	reflectUniforms();
+	resolveHoisted();
+}
+
+void Shader::checkCompileAndLink()
+{
+	// every log is printed, the fragment one may explain a failed vertex stage
+	bool vertexCompiled = ShaderCompiler::checkStage(pendingVertex, GL_VERTEX_SHADER, vertexFiles);
+	bool fragmentCompiled = ShaderCompiler::checkStage(pendingFragment, GL_FRAGMENT_SHADER, fragmentFiles);
+	std::string label = (vertexFiles.empty() ? "" : vertexFiles[0]) + " " + (fragmentFiles.empty() ? "" : fragmentFiles[0]);
+	bool linked = ShaderCompiler::checkLink(ID, "PROGRAM", label, cacheKey);
+	valid = valid && vertexCompiled && fragmentCompiled && linked;
 	// delete shaders; theyre linked into our program and no longer necessary
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
+	glDeleteShader(pendingVertex);
+	glDeleteShader(pendingFragment);
+	pendingVertex = pendingFragment = 0;
+}
+
+bool Shader::parallelCompileSupported()
+{
+	return GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+}
+
+bool Shader::spirvSupported()
+{
+	return GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_gl_spirv;
+}
+
+bool Shader::spirvAvailable(const SpirvModules& modules)
+{
+	if (!spirvSupported())
+		return false;
+	std::error_code ec;
+	for (const char* path : { modules.vertexPath, modules.fragmentPath })
+	{
+		if (!std::filesystem::is_regular_file(path, ec))
+		{
+			std::cout << "WARNING::SHADER::SPIRV::MODULE_NOT_BUILT " << path << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string Shader::specializationKey(const SpecializationConstants& constants)
+{
+	std::string key;
+	for (const SpecializationConstant& constant : constants)
+		key += std::to_string(constant.id) + "=" + std::to_string(constant.value) + ";";
+	return key;
+}
+
+void Shader::reflectUniforms()
+{
+	uniforms.clear();
+	uniformNames.clear();
+	shadow.clear();
+	shadowValid.clear();
+
+	int count = 0, maxLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+	for (int i = 0; i < count; i++)
+	{
+		int length = 0, size = 0;
+		GLenum type;
+		glGetActiveUniform(ID, i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+		std::string name(nameBuffer.data(), length);
+		int location = -1;
+		if (spirv)
+		{
+			// names are optional in SPIR-V: go by the explicit location instead
+			GLenum property = GL_LOCATION;
+			glGetProgramResourceiv(ID, GL_UNIFORM, i, 1, &property, 1, NULL, &location);
+			for (const auto& named : uniformLocations)
+			{
+				if (named.second == location)
+					name = named.first;
+			}
+		}
+		else
+			location = glGetUniformLocation(ID, name.c_str());
+		// uniform block members have no location; they are set through their buffer
+		if (location < 0)
+			continue;
+		// arrays are reported as "name[0]"; look them up by their plain name
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			name.resize(name.size() - 3);
+		addUniform(name, location, type, size);
+	}
+}
+
+UniformHandle Shader::addUniform(const std::string& name, int location, unsigned int type, int size)
+{
+	UniformInfo info;
+	info.nameHash = hashName(name.c_str());
+	info.location = location;
+	info.type = type;
+	info.size = size;
+	info.shadowOffset = (unsigned int)shadow.size();
+	info.shadowSize = uniformTypeSize(type);
+	info.hoistedOperand = false;
+	uniforms.push_back(info);
+	uniformNames.push_back(name);
+	shadow.resize(shadow.size() + info.shadowSize);
+	// the initial value is unknown to us, so the first set always uploads
+	shadowValid.push_back(false);
+
+	UniformHandle handle;
+	handle.index = (int)uniforms.size() - 1;
+	return handle;
+}
+
+void Shader::resolveHoisted()
+{
+	hoisted.clear();
+	for (int i = 0; i < hoistedUniformCount; i++)
+	{
+		const HoistedUniform& entry = hoistedUniforms[i];
+		if ((vertexFiles.empty() || entry.shader != vertexFiles[0]) &&
+			(fragmentFiles.empty() || entry.shader != fragmentFiles[0]))
+			continue;
+		HoistedProduct product;
+		product.target = getUniform(std::string(entry.name).c_str());
+		// optimized away by the compiler: nothing to compute
+		if (!product.target.isValid())
+			continue;
+
+		bool resolved = true;
+		for (int j = 0; j < entry.operandCount; j++)
+		{
+			std::string_view operandName = entry.operands[j];
+			HoistedOperand operand = { nullptr, UniformHandle() };
+			size_t dot = operandName.find('.');
+			if (dot != std::string_view::npos)
+			{
+				// block members come from the CPU copy of their buffer
+				if (operandName.substr(0, dot) == FrameUniforms::blockName)
+					operand.frameValue = FrameUniforms::member(operandName.substr(dot + 1));
+				if (!operand.frameValue)
+				{
+					std::cout << "ERROR::SHADER::HOISTED_OPERAND_UNKNOWN " << operandName << " in " << entry.shader << std::endl;
+					resolved = false;
+				}
+			}
+			else
+			{
+				std::string name(operandName);
+				operand.uniform = getUniform(name.c_str());
+				// the program may not use it anymore, but setMat4 still has to find it
+				if (!operand.uniform.isValid())
+					operand.uniform = addUniform(name, -1, GL_FLOAT_MAT4, 1);
+				uniforms[operand.uniform.index].hoistedOperand = true;
+			}
+			product.operands.push_back(operand);
+		}
+		if (resolved)
+			hoisted.push_back(product);
+	}
+	hoistedDirty = !hoisted.empty();
+}
+
+void Shader::updateHoisted() const
+{
+	hoistedDirty = false;
+	for (const HoistedProduct& product : hoisted)
+	{
+		glm::mat4 value(1.0f);
+		for (const HoistedOperand& operand : product.operands)
+		{
+			glm::mat4 factor;
+			if (operand.frameValue)
+				factor = *operand.frameValue;
+			else
+				memcpy(glm::value_ptr(factor), &shadow[uniforms[operand.uniform.index].shadowOffset], sizeof(factor));
+			value = value * factor;
+		}
+		// unchanged products are elided like any other uniform
+		if (needsUpload(product.target, glm::value_ptr(value), sizeof(float) * 16))
+			glUniformMatrix4fv(location(product.target), 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+UniformHandle Shader::getUniform(const char* name) const
+{
+	UniformHandle handle;
+	unsigned int hash = hashName(name);
+	for (size_t i = 0; i < uniforms.size(); i++)
+	{
+		if (uniforms[i].nameHash == hash && uniformNames[i] == name)
+		{
+			handle.index = (int)i;
+			break;
+		}
+	}
+	return handle;
+}
 
+int Shader::location(UniformHandle handle) const
+{
+	// -1 makes glUniform* a silent no-op, like glGetUniformLocation did
+	return handle.isValid() ? uniforms[handle.index].location : -1;
+}
+
+bool Shader::needsUpload(UniformHandle handle, const void* value, unsigned int size) const
+{
+	// nothing to do for uniforms the program does not use
+	if (!handle.isValid())
+		return false;
+	const UniformInfo& info = uniforms[handle.index];
+	if (info.location < 0)
+	{
+		// operand of a hoisted product only: kept on the CPU, never uploaded
+		memcpy(&shadow[info.shadowOffset], value, size < info.shadowSize ? size : info.shadowSize);
+		shadowValid[handle.index] = true;
+		return false;
+	}
+	if (size > info.shadowSize)
+	{
+		// type mismatch: let the driver report it
+		frameStats.issued++;
+		return true;
+	}
+	unsigned char* current = &shadow[info.shadowOffset];
+	if (shadowValid[handle.index] && memcmp(current, value, size) == 0)
+	{
+		frameStats.elided++;
+		return false;
+	}
+	memcpy(current, value, size);
+	shadowValid[handle.index] = true;
+	frameStats.issued++;
+	return true;
 }
 
 void Shader::use()
 {
-	glUseProgram(ID);
+	GLState::useProgram(ID);
+	// the FrameData operands may have changed since the last draw
+	if (!hoisted.empty())
+		hoistedDirty = true;
+}
+
+void Shader::flush() const
+{
+	if (hoistedDirty)
+		updateHoisted();
 }
 
 void Shader::setBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	setBool(getUniform(name.c_str()), value);
 }
 void Shader::setInt(const std::string& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	setInt(getUniform(name.c_str()), value);
 }
 void Shader::setFloat(const std::string& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	setFloat(getUniform(name.c_str()), value);
+}
+void Shader::setVec3(const std::string& name, const glm::vec3& value) const
+{
+	setVec3(getUniform(name.c_str()), value);
+}
+void Shader::setVec4(const std::string& name, const glm::vec4& value) const
+{
+	setVec4(getUniform(name.c_str()), value);
+}
+void Shader::setMat4(const std::string& name, const glm::mat4& value) const
+{
+	setMat4(getUniform(name.c_str()), value);
+}
+
+void Shader::setBool(UniformHandle handle, bool value) const
+{
+	int intValue = (int)value;
+	if (needsUpload(handle, &intValue, sizeof(intValue)))
+		glUniform1i(location(handle), intValue);
+}
+void Shader::setInt(UniformHandle handle, int value) const
+{
+	if (needsUpload(handle, &value, sizeof(value)))
+		glUniform1i(location(handle), value);
+}
+void Shader::setFloat(UniformHandle handle, float value) const
+{
+	if (needsUpload(handle, &value, sizeof(value)))
+		glUniform1f(location(handle), value);
+}
+void Shader::setVec3(UniformHandle handle, const glm::vec3& value) const
+{
+	if (needsUpload(handle, glm::value_ptr(value), sizeof(float) * 3))
+		glUniform3fv(location(handle), 1, glm::value_ptr(value));
+}
+void Shader::setVec4(UniformHandle handle, const glm::vec4& value) const
+{
+	if (needsUpload(handle, glm::value_ptr(value), sizeof(float) * 4))
+		glUniform4fv(location(handle), 1, glm::value_ptr(value));
+}
+void Shader::setMat4(UniformHandle handle, const glm::mat4& value) const
+{
+	if (needsUpload(handle, glm::value_ptr(value), sizeof(float) * 16))
+		glUniformMatrix4fv(location(handle), 1, GL_FALSE, glm::value_ptr(value));
+	if (handle.isValid() && uniforms[handle.index].hoistedOperand)
+		hoistedDirty = true;
 }
\ No newline at end of file
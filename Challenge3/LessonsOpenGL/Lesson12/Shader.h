@@ -4,20 +4,173 @@
 #define SHADER_H
 
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ShaderPreprocessor.h"
+
+struct EmbeddedShader;
+
+#include <glm/glm.hpp>
+
+// pre-resolved uniform: an index into the program's uniform table
+struct UniformHandle
+{
+	int index = -1;
+	bool isValid() const { return index >= 0; }
+};
+
+// one active uniform as reported by glGetActiveUniform after linking
+struct UniformInfo
+{
+	unsigned int nameHash;
+	int location;
+	unsigned int type;
+	int size;
+	// slice of the shadow copy holding the value the program currently has
+	unsigned int shadowOffset;
+	unsigned int shadowSize;
+	// setting it makes the hoisted products out of date
+	bool hoistedOperand;
+};
+
+// uniform uploads issued to the driver vs. skipped because the value was unchanged
+struct UniformStats
+{
+	unsigned int issued = 0;
+	unsigned int elided = 0;
+};
+
+// specialization constant of a SPIR-V module: constant_id -> value, as the
+// raw 32 bits of the constant (ints as they are, bools as 0/1, floats bit-cast)
+struct SpecializationConstant
+{
+	unsigned int id;
+	unsigned int value;
+};
+typedef std::vector<SpecializationConstant> SpecializationConstants;
+
+// a pair of precompiled SPIR-V modules (see res/spirv); SPIR-V programs do not
+// have to keep uniform names, so the explicit locations they use are named here
+struct SpirvModules
+{
+	const char* vertexPath;
+	const char* fragmentPath;
+	std::vector<std::pair<std::string, int>> uniformLocations;
+};
 
 class Shader
 {
 public:
 	// the program ID
 	unsigned int ID;
-	// constructor reads and builds the shader
-	Shader(const char* vertexPath, const char* fragmentPath);
+	// constructor reads and builds the shader; a deferred shader only submits
+	// the compile and link, and is usable after finish() (see ShaderBatch)
+	Shader(const char* vertexPath, const char* fragmentPath, bool deferred = false);
+	// same, building the variant selected by a set of #defines
+	Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, bool deferred = false);
+	// builds from sources embedded in the binary (EmbeddedShaders.h); includes are
+	// looked up in the same table, PG_SHADER_DIR overrides them from disk
+	Shader(const EmbeddedShader& vertex, const EmbeddedShader& fragment, const ShaderDefines& defines = ShaderDefines());
+	// same, mapping the sources through a store shared with other programs
+	Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, ShaderFiles& files, bool deferred);
+	// loads SPIR-V modules and specializes them: no GLSL front end at runtime,
+	// variants differ only by their specialization constants
+	Shader(const SpirvModules& modules, const SpecializationConstants& constants = SpecializationConstants(), bool deferred = false);
+	// true once the driver is done compiling and linking (never blocks)
+	bool isReady() const;
+	// waits for the compile/link, reports errors and reflects the program
+	void finish();
+	// false if a source could not be read or the program failed to compile/link
+	bool isValid() const { return valid; }
+	// GL_KHR/ARB_parallel_shader_compile: compile status can be polled
+	static bool parallelCompileSupported();
+	// GL 4.6 or GL_ARB_gl_spirv: SPIR-V modules can be loaded
+	static bool spirvSupported();
+	// the driver loads SPIR-V and both modules have been built (see README.md)
+	static bool spirvAvailable(const SpirvModules& modules);
+	// "id=value;" list telling specialized variants apart
+	static std::string specializationKey(const SpecializationConstants& constants);
 	// use/activate the shader
 	void use();
+	// uploads the products hoisted out of the shader if their operands changed:
+	// once per draw, after the last setter
+	void flush() const;
 	unsigned int getShaderProgramID(){ return ID; }
+	// resolves a uniform once; invalid handle if the program does not use it
+	UniformHandle getUniform(const char* name) const;
 	// utility uniform functions
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
 	void setFloat(const std::string& name, float value) const;
+	void setVec3(const std::string& name, const glm::vec3& value) const;
+	void setVec4(const std::string& name, const glm::vec4& value) const;
+	void setMat4(const std::string& name, const glm::mat4& value) const;
+	// same, with a handle from getUniform (no lookup at all)
+	// like glUniform*, these write to the program in use: call use() first
+	// setMat4 on an operand of a hoisted product leaves it to flush()
+	void setBool(UniformHandle handle, bool value) const;
+	void setInt(UniformHandle handle, int value) const;
+	void setFloat(UniformHandle handle, float value) const;
+	void setVec3(UniformHandle handle, const glm::vec3& value) const;
+	void setVec4(UniformHandle handle, const glm::vec4& value) const;
+	void setMat4(UniformHandle handle, const glm::mat4& value) const;
+
+	// counters for the current frame, shared by every program
+	static UniformStats frameStats;
+	static void resetFrameStats() { frameStats = UniformStats(); }
+
+private:
+	// a uniform of an optimized shader that stands for a product of other
+	// matrices (HoistedUniforms.h), computed here instead of per vertex
+	struct HoistedOperand
+	{
+		// a FrameData member, or else a uniform of this program
+		const glm::mat4* frameValue;
+		UniformHandle uniform;
+	};
+	struct HoistedProduct
+	{
+		UniformHandle target;
+		std::vector<HoistedOperand> operands;
+	};
+
+	// active uniforms, filled at link time; names are kept apart so the
+	// table used by the setters stays small. Operands of hoisted products the
+	// program no longer uses are kept too, with location -1
+	std::vector<UniformInfo> uniforms;
+	std::vector<std::string> uniformNames;
+	// CPU-side copy of every uniform value, so unchanged values are not re-uploaded
+	mutable std::vector<unsigned char> shadow;
+	mutable std::vector<bool> shadowValid;
+	std::vector<HoistedProduct> hoisted;
+	// an operand changed (or FrameData may have) since the products were uploaded
+	mutable bool hoistedDirty = false;
+
+	// shader objects still being compiled (0 once linked or loaded from the cache)
+	unsigned int pendingVertex;
+	unsigned int pendingFragment;
+	bool ready;
+	bool valid;
+	std::string cacheKey;
+	// files making up each stage, to make sense of compiler errors
+	std::vector<std::string> vertexFiles;
+	std::vector<std::string> fragmentFiles;
+	// SPIR-V programs are reflected by location, named from uniformLocations
+	bool spirv;
+	std::vector<std::pair<std::string, int>> uniformLocations;
+
+	void build(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, ShaderFiles& files, bool deferred);
+	void submit(const std::vector<std::string_view>& vertexCode, const std::vector<std::string_view>& fragmentCode);
+	void buildSpirv(const SpirvModules& modules, const SpecializationConstants& constants, bool deferred);
+	void submitSpirv(std::string_view vertexModule, std::string_view fragmentModule, const SpecializationConstants& constants);
+	void checkCompileAndLink();
+	void reflectUniforms();
+	void resolveHoisted();
+	void updateHoisted() const;
+	UniformHandle addUniform(const std::string& name, int location, unsigned int type, int size);
+	int location(UniformHandle handle) const;
+	bool needsUpload(UniformHandle handle, const void* value, unsigned int size) const;
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,66 @@
+#include "ShaderBatch.h"
+
+#include <glad/glad.h>
+#include <iostream>
+
+ShaderBatch::ShaderBatch(ShaderFiles::Origin origin)
+	: origin(origin), files(origin), finished(0), start(std::chrono::steady_clock::now()), submitMs(0.0)
+{
+	// let the driver use as many compiler threads as it likes
+	if (GLAD_GL_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+	else if (GLAD_GL_ARB_parallel_shader_compile)
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+}
+
+Shader& ShaderBatch::add(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines)
+{
+	std::string key = std::string(vertexPath) + "|" + fragmentPath + "|" + ShaderPreprocessor::permutationKey(defines);
+	auto variant = variants.find(key);
+	if (variant != variants.end())
+		return *variant->second;
+
+	shaders.push_back(std::make_unique<Shader>(vertexPath, fragmentPath, defines, files, true));
+	variants[key] = shaders.back().get();
+	submitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return *shaders.back();
+}
+
+Shader& ShaderBatch::add(const SpirvModules& modules, const SpecializationConstants& constants)
+{
+	std::string key = std::string("spirv|") + modules.vertexPath + "|" + modules.fragmentPath + "|" + Shader::specializationKey(constants);
+	auto variant = variants.find(key);
+	if (variant != variants.end())
+		return *variant->second;
+
+	shaders.push_back(std::make_unique<Shader>(modules, constants, true));
+	variants[key] = shaders.back().get();
+	submitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return *shaders.back();
+}
+
+bool ShaderBatch::poll()
+{
+	// programs are finished in order, so a slow one only delays those after it
+	while (finished < shaders.size() && shaders[finished]->isReady())
+		shaders[finished++]->finish();
+	return finished == shaders.size();
+}
+
+bool ShaderBatch::finish()
+{
+	while (finished < shaders.size())
+		shaders[finished++]->finish();
+	// every source has been handed to the driver, the mappings can go
+	files = ShaderFiles(origin);
+
+	double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "SHADER::BATCH " << shaders.size() << " programs, submitted in " << submitMs <<
+		" ms, ready after " << totalMs << " ms" <<
+		(Shader::parallelCompileSupported() ? " (parallel compile)" : "") << std::endl;
+
+	bool valid = true;
+	for (const auto& shader : shaders)
+		valid = valid && shader->isValid();
+	return valid;
+}
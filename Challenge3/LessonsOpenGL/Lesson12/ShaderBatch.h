@@ -0,0 +1,44 @@
+#pragma once
+
+#ifndef SHADERBATCH_H
+#define SHADERBATCH_H
+
+#include "Shader.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Submits many programs up front and checks on them later, so the driver can
+// compile them (in parallel with GL_KHR/ARB_parallel_shader_compile) while the
+// application loads textures and fonts. The batch owns its programs, and asking
+// twice for the same files and defines returns the same variant.
+class ShaderBatch
+{
+public:
+	// sources are mapped from disk, or taken from EmbeddedShaders.h
+	explicit ShaderBatch(ShaderFiles::Origin origin = ShaderFiles::Disk);
+	// reads the sources and submits the compile; the Shader is usable after finish()
+	Shader& add(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines = ShaderDefines());
+	// same for a pair of SPIR-V modules, one variant per set of specialization constants
+	Shader& add(const SpirvModules& modules, const SpecializationConstants& constants = SpecializationConstants());
+	// finishes the programs that are already done; true when all of them are
+	bool poll();
+	// waits for the rest and prints how long the batch took; false if any program is not valid
+	bool finish();
+	size_t size() const { return shaders.size(); }
+
+private:
+	std::vector<std::unique_ptr<Shader>> shaders;
+	// files + permutation (or specialization) key -> program
+	std::map<std::string, Shader*> variants;
+	// sources mapped once for the whole batch
+	ShaderFiles::Origin origin;
+	ShaderFiles files;
+	size_t finished;
+	std::chrono::steady_clock::time_point start;
+	double submitMs;
+};
+#endif
@@ -0,0 +1,194 @@
+#include "ShaderCache.h"
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+std::string ShaderCache::directory = "cache/shaders";
+unsigned int ShaderCache::hits = 0;
+unsigned int ShaderCache::misses = 0;
+
+namespace
+{
+	// header written in front of every binary blob
+	struct BlobHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t binaryFormat;
+		uint32_t length;
+	};
+	const char blobMagic[4] = { 'P', 'G', 'S', 'B' };
+	const uint32_t blobVersion = 1;
+
+	// 64-bit FNV-1a, good enough to tell shader sources apart
+	uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	uint64_t fnv1a(uint64_t hash, const char* text)
+	{
+		// the terminating zero separates consecutive fields
+		return fnv1a(hash, text ? text : "", text ? strlen(text) + 1 : 1);
+	}
+
+	std::string blobPath(const std::string& key)
+	{
+		return ShaderCache::directory + "/" + key + ".bin";
+	}
+
+	// a blob that can never load: drop it so it is not read again on every run
+	void removeBlob(const std::string& key)
+	{
+		std::error_code ec;
+		std::filesystem::remove(blobPath(key), ec);
+	}
+}
+
+bool ShaderCache::isSupported()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		int formats = 0;
+		if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		supported = formats > 0 ? 1 : 0;
+	}
+	return supported == 1;
+}
+
+std::string ShaderCache::makeKey(const std::vector<std::string_view>& vertexCode, const std::vector<std::string_view>& fragmentCode)
+{
+	uint64_t hash = 14695981039346656037ull;
+	// hashing the slices one after the other is the same as hashing the joined text
+	for (std::string_view segment : vertexCode)
+		hash = fnv1a(hash, segment.data(), segment.size());
+	hash = fnv1a(hash, "");
+	for (std::string_view segment : fragmentCode)
+		hash = fnv1a(hash, segment.data(), segment.size());
+	hash = fnv1a(hash, "");
+	hash = fnv1a(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+	hash = fnv1a(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	hash = fnv1a(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+	char key[17];
+	snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+	return key;
+}
+
+bool ShaderCache::load(unsigned int program, const std::string& key)
+{
+	if (!isSupported())
+	{
+		misses++;
+		return false;
+	}
+
+	std::ifstream file(blobPath(key), std::ios::binary);
+	if (!file)
+	{
+		misses++;
+		return false;
+	}
+	// the length comes from disk: it is only trusted once the file is known to hold that much
+	std::error_code ec;
+	uintmax_t fileSize = std::filesystem::file_size(blobPath(key), ec);
+	BlobHeader header;
+	if (ec || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		memcmp(header.magic, blobMagic, sizeof(blobMagic)) != 0 || header.version != blobVersion ||
+		header.length == 0 || header.length != fileSize - sizeof(header))
+	{
+		std::cout << "WARNING::SHADER::CACHE::BLOB_REJECTED " << key << std::endl;
+		file.close();
+		removeBlob(key);
+		misses++;
+		return false;
+	}
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), binary.size()))
+	{
+		std::cout << "WARNING::SHADER::CACHE::BLOB_REJECTED " << key << std::endl;
+		file.close();
+		removeBlob(key);
+		misses++;
+		return false;
+	}
+
+	glProgramBinary(program, header.binaryFormat, binary.data(), header.length);
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		// the driver rejected the blob (e.g. after an update): drop it and compile from source
+		std::cout << "WARNING::SHADER::CACHE::BINARY_REJECTED " << key << std::endl;
+		file.close();
+		removeBlob(key);
+		misses++;
+		return false;
+	}
+	hits++;
+	return true;
+}
+
+void ShaderCache::store(unsigned int program, const std::string& key)
+{
+	if (!isSupported())
+		return;
+
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	BlobHeader header;
+	memcpy(header.magic, blobMagic, sizeof(blobMagic));
+	header.version = blobVersion;
+	std::vector<char> binary(length);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, length, NULL, &binaryFormat, binary.data());
+	header.binaryFormat = binaryFormat;
+	header.length = static_cast<uint32_t>(length);
+
+	// written aside and renamed into place, so a crash never leaves a truncated blob
+	static unsigned int writes = 0;
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+	std::string path = blobPath(key);
+	std::string temporary = path + "." + std::to_string(writes++) + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+			!file.write(binary.data(), binary.size()) || !file.flush())
+		{
+			std::cout << "ERROR::SHADER::CACHE::WRITE_FAILED " << path << std::endl;
+			file.close();
+			std::filesystem::remove(temporary, ec);
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, path, ec);
+	if (ec)
+	{
+		std::cout << "ERROR::SHADER::CACHE::WRITE_FAILED " << path << ": " << ec.message() << std::endl;
+		std::filesystem::remove(temporary, ec);
+	}
+}
+
+void ShaderCache::printStats()
+{
+	std::cout << "SHADER::CACHE hits: " << hits << " misses: " << misses <<
+		(isSupported() ? "" : " (program binaries not supported by the driver)") << std::endl;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+// Entries are keyed by a hash of the shader sources plus the driver
+// vendor/renderer/version strings, so a driver update invalidates them.
+class ShaderCache
+{
+public:
+	// directory where the program binaries are written
+	static std::string directory;
+	// hit/miss counters since startup
+	static unsigned int hits;
+	static unsigned int misses;
+
+	// true when the driver can save and reload program binaries
+	static bool isSupported();
+	// builds the cache key for a pair of (preprocessed) shader sources on the current driver
+	static std::string makeKey(const std::vector<std::string_view>& vertexCode, const std::vector<std::string_view>& fragmentCode);
+	// loads a cached binary into program; false (miss) if absent or rejected by the driver
+	static bool load(unsigned int program, const std::string& key);
+	// saves the binary of a successfully linked program
+	static void store(unsigned int program, const std::string& key);
+	// prints the hit/miss counters
+	static void printStats();
+};
+#endif
@@ -0,0 +1,104 @@
+#include "ShaderCompiler.h"
+#include "ShaderCache.h"
+#include "FrameData.h"
+
+#include <glad/glad.h>
+#include <iostream>
+
+namespace
+{
+	// the driver's log, whatever its length
+	std::string shaderLog(unsigned int shader)
+	{
+		int length = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+		std::string log(length > 0 ? length : 1, '\0');
+		glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, &log[0]);
+		return log.c_str();
+	}
+
+	std::string programLog(unsigned int program)
+	{
+		int length = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+		std::string log(length > 0 ? length : 1, '\0');
+		glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, &log[0]);
+		return log.c_str();
+	}
+}
+
+unsigned int ShaderCompiler::submitStage(unsigned int type, const std::vector<std::string_view>& code)
+{
+	// hands the preprocessed slices to the driver without joining them
+	std::vector<const char*> strings;
+	std::vector<int> lengths;
+	for (std::string_view segment : code)
+	{
+		// empty files map to no memory at all
+		if (segment.empty())
+			continue;
+		strings.push_back(segment.data());
+		lengths.push_back((int)segment.size());
+	}
+	unsigned int shader = glCreateShader(type);
+	glShaderSource(shader, (GLsizei)strings.size(), strings.data(), lengths.data());
+	glCompileShader(shader);
+	return shader;
+}
+
+void ShaderCompiler::submitLink(unsigned int program)
+{
+	if (ShaderCache::isSupported())
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program);
+}
+
+bool ShaderCompiler::checkStage(unsigned int shader, unsigned int type, const std::vector<std::string>& files)
+{
+	int success;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (success)
+		return true;
+	std::cout << "ERROR::SHADER::" << stageName(type) << "::COMPILATION_FAILED\n" << shaderLog(shader);
+	// "#line n file" numbers in the log refer to this list
+	for (size_t i = 0; i < files.size(); i++)
+		std::cout << "\n  " << i << ": " << files[i];
+	std::cout << std::endl;
+	return false;
+}
+
+bool ShaderCompiler::checkLink(unsigned int program, const char* kind, const std::string& label, const std::string& cacheKey)
+{
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		std::cout << "ERROR::SHADER::" << kind << "::LINKING_FAILED " << label << "\n" << programLog(program) << std::endl;
+		return false;
+	}
+	ShaderCache::store(program, cacheKey);
+	return true;
+}
+
+void ShaderCompiler::bindUniformBlocks(unsigned int program)
+{
+	// the block index is per program, the binding point is fixed for the whole app
+	unsigned int frameBlock = glGetUniformBlockIndex(program, FrameUniforms::blockName);
+	if (frameBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, frameBlock, FrameUniforms::binding);
+}
+
+const char* ShaderCompiler::stageName(unsigned int type)
+{
+	switch (type)
+	{
+	case GL_VERTEX_SHADER:
+		return "VERTEX";
+	case GL_FRAGMENT_SHADER:
+		return "FRAGMENT";
+	case GL_GEOMETRY_SHADER:
+		return "GEOMETRY";
+	default:
+		return "STAGE";
+	}
+}
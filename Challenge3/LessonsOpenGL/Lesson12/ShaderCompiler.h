@@ -0,0 +1,31 @@
+#pragma once
+
+#ifndef SHADERCOMPILER_H
+#define SHADERCOMPILER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The compile/link steps shared by Shader (linked programs) and ShaderStage
+// (separable ones), so both report errors and use the cache the same way.
+// Submitting never asks for a status: that is left to the check functions,
+// which a deferred Shader only calls once the driver is done.
+class ShaderCompiler
+{
+public:
+	// creates a shader object and starts compiling the preprocessed slices
+	static unsigned int submitStage(unsigned int type, const std::vector<std::string_view>& code);
+	// starts linking the attached stages, keeping the binary retrievable for ShaderCache
+	static void submitLink(unsigned int program);
+	// false, with the log and the files "#line n file" refers to printed, if the stage failed to compile
+	static bool checkStage(unsigned int shader, unsigned int type, const std::vector<std::string>& files);
+	// false, with the log printed, if the program failed to link; a linked
+	// program is stored in ShaderCache under cacheKey
+	static bool checkLink(unsigned int program, const char* kind, const std::string& label, const std::string& cacheKey);
+	// binds the program's shared uniform blocks (FrameData) to their fixed binding points
+	static void bindUniformBlocks(unsigned int program);
+	// "VERTEX", "FRAGMENT"... as used in the error messages
+	static const char* stageName(unsigned int type);
+};
+#endif
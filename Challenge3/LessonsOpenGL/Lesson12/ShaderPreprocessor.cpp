@@ -0,0 +1,307 @@
+#include "ShaderPreprocessor.h"
+
+#include "EmbeddedShaders.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+	std::string directoryOf(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+
+	// "#name" directive at the start of the line, ignoring blanks; returns the rest of the line
+	bool directive(std::string_view line, const char* name, std::string_view& rest)
+	{
+		size_t i = line.find_first_not_of(" \t");
+		if (i == std::string_view::npos || line[i] != '#')
+			return false;
+		i = line.find_first_not_of(" \t", i + 1);
+		std::string_view word(name);
+		if (i == std::string_view::npos || line.compare(i, word.size(), word) != 0)
+			return false;
+		rest = line.substr(i + word.size());
+		// #if is not the start of #ifdef
+		if (!rest.empty() && (isalnum((unsigned char)rest[0]) || rest[0] == '_'))
+			return false;
+		return true;
+	}
+
+	// the macro name a directive starts with
+	std::string_view macroName(std::string_view rest)
+	{
+		size_t start = rest.find_first_not_of(" \t");
+		if (start == std::string_view::npos)
+			return std::string_view();
+		size_t end = start;
+		while (end < rest.size() && (isalnum((unsigned char)rest[end]) || rest[end] == '_'))
+			end++;
+		return rest.substr(start, end - start);
+	}
+}
+
+ShaderFiles::ShaderFiles(Origin origin)
+	: origin(origin)
+{
+}
+
+std::string ShaderFiles::overrideDirectory()
+{
+	const char* directory = std::getenv("PG_SHADER_DIR");
+	return directory ? directory : "";
+}
+
+bool ShaderFiles::find(const std::string& path, std::string_view& source)
+{
+	if (origin == Disk)
+	{
+		const MappedFile* file = map(path, true);
+		if (file)
+			source = file->view();
+		return file != nullptr;
+	}
+
+	static const std::string developmentDirectory = overrideDirectory();
+	if (!developmentDirectory.empty())
+	{
+		const MappedFile* file = map(developmentDirectory + "/" + path, false);
+		if (file)
+		{
+			source = file->view();
+			return true;
+		}
+	}
+	for (const EmbeddedShader& shader : embeddedShaders)
+	{
+		if (shader.path == path)
+		{
+			source = shader.source;
+			return true;
+		}
+	}
+	std::cout << "ERROR::SHADER::NOT_EMBEDDED " << path << " (rerun tools/embed_shaders)" << std::endl;
+	return false;
+}
+
+const MappedFile* ShaderFiles::map(const std::string& path, bool reportErrors)
+{
+	auto known = files.find(path);
+	if (known != files.end())
+		return known->second.get();
+
+	// one directory handle per directory, files are opened relative to it
+	std::string directory = directoryOf(path);
+	std::unique_ptr<MappedDirectory>& handle = directories[directory];
+	if (!handle)
+	{
+		handle = std::make_unique<MappedDirectory>();
+		if (!handle->open(directory.empty() ? "." : directory.substr(0, directory.size() - 1)) && reportErrors)
+			std::cout << "ERROR::SHADER::DIRECTORY_NOT_SUCCESFULLY_OPENED " << handle->error() << std::endl;
+	}
+
+	std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+	if (!file->open(*handle, path.substr(directory.size())))
+	{
+		if (reportErrors)
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << file->error() << std::endl;
+		return nullptr;
+	}
+	return (files[path] = std::move(file)).get();
+}
+
+std::string ShaderPreprocessor::permutationKey(const ShaderDefines& defines)
+{
+	ShaderDefines sorted(defines);
+	std::sort(sorted.begin(), sorted.end());
+	std::string key;
+	for (const auto& define : sorted)
+		key += define.first + "=" + define.second + ";";
+	return key;
+}
+
+bool ShaderPreprocessor::process(ShaderFiles& sourceFiles, const std::string& path, const ShaderDefines& defines)
+{
+	store = &sourceFiles;
+	output.clear();
+	fileNames.clear();
+	storage.clear();
+	pendingDefines = &defines;
+	conditionals.clear();
+	defined.clear();
+	uncertain.clear();
+	included.clear();
+	for (const auto& define : defines)
+		defined.insert(define.first);
+	bool ok = append(path, Compiled);
+	// no #version: the defines simply go first
+	if (pendingDefines && !pendingDefines->empty())
+	{
+		storage.push_back(defineLines(*pendingDefines));
+		output.insert(output.begin(), storage.back());
+	}
+	pendingDefines = nullptr;
+	return ok;
+}
+
+std::string ShaderPreprocessor::defineLines(const ShaderDefines& defines) const
+{
+	std::string lines;
+	for (const auto& define : defines)
+		lines += "#define " + define.first + " " + define.second + "\n";
+	return lines;
+}
+
+void ShaderPreprocessor::emit(std::string text)
+{
+	storage.push_back(std::move(text));
+	output.push_back(storage.back());
+}
+
+ShaderPreprocessor::Reach ShaderPreprocessor::reach() const
+{
+	Reach result = Compiled;
+	for (const Conditional& block : conditionals)
+	{
+		if (block.reach == Skipped)
+			return Skipped;
+		if (block.reach == Unknown)
+			result = Unknown;
+	}
+	return result;
+}
+
+ShaderPreprocessor::Reach ShaderPreprocessor::macroState(std::string_view name) const
+{
+	std::string key(name);
+	// predefined by the compiler (GL_core_profile, extension macros, __VERSION__)
+	if (uncertain.count(key) || key.compare(0, 3, "GL_") == 0 || key.compare(0, 2, "__") == 0)
+		return Unknown;
+	return defined.count(key) ? Compiled : Skipped;
+}
+
+void ShaderPreprocessor::conditional(std::string_view line)
+{
+	std::string_view rest;
+	if (directive(line, "ifdef", rest) || directive(line, "ifndef", rest))
+	{
+		Reach state = macroState(macroName(rest));
+		if (directive(line, "ifndef", rest) && state != Unknown)
+			state = state == Compiled ? Skipped : Compiled;
+		conditionals.push_back({ state, state == Compiled, state != Skipped });
+	}
+	else if (directive(line, "if", rest))
+		conditionals.push_back({ Unknown, false, true });
+	else if (directive(line, "elif", rest) || directive(line, "else", rest))
+	{
+		if (conditionals.empty())
+			return;
+		Conditional& block = conditionals.back();
+		if (block.taken)
+			block.reach = Skipped;
+		else if (directive(line, "elif", rest) || block.maybeTaken)
+			block.reach = Unknown;
+		else
+			block.reach = Compiled;
+		block.taken = block.taken || block.reach == Compiled;
+		block.maybeTaken = block.maybeTaken || block.reach != Skipped;
+	}
+	else if (directive(line, "endif", rest))
+	{
+		// unbalanced: left for the compiler to report
+		if (!conditionals.empty())
+			conditionals.pop_back();
+	}
+	else if (directive(line, "define", rest) || directive(line, "undef", rest))
+	{
+		Reach state = reach();
+		std::string name(macroName(rest));
+		if (state == Unknown)
+			uncertain.insert(name);
+		else if (state == Compiled)
+		{
+			uncertain.erase(name);
+			if (directive(line, "define", rest))
+				defined.insert(name);
+			else
+				defined.erase(name);
+		}
+	}
+}
+
+bool ShaderPreprocessor::append(const std::string& path, Reach inclusion)
+{
+	// each file goes in once, like #pragma once; only an inclusion known to be
+	// compiled counts, as one the compiler may skip would leave nothing behind
+	if (included.count(path))
+		return true;
+	std::string_view source;
+	if (!store->find(path, source))
+		return false;
+	if (inclusion == Compiled)
+		included.insert(path);
+	size_t fileIndex = fileNames.size();
+	fileNames.push_back(path);
+	// included files are numbered from their own first line
+	if (fileIndex > 0)
+		emit("#line 1 " + std::to_string(fileIndex) + "\n");
+
+	size_t segmentStart = 0;
+	size_t lineStart = 0;
+	int lineNumber = 1;
+	bool ok = true;
+	while (lineStart < source.size())
+	{
+		size_t lineEnd = source.find('\n', lineStart);
+		lineEnd = lineEnd == std::string_view::npos ? source.size() : lineEnd + 1;
+		std::string_view line = source.substr(lineStart, lineEnd - lineStart);
+		std::string_view rest;
+
+		if (pendingDefines && directive(line, "version", rest))
+		{
+			// the defines go right after #version, which has to stay first
+			output.push_back(source.substr(segmentStart, lineEnd - segmentStart));
+			std::string injected;
+			if (line.back() != '\n')
+				injected += "\n";
+			injected += defineLines(*pendingDefines);
+			injected += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+			emit(injected);
+			segmentStart = lineEnd;
+			pendingDefines = nullptr;
+		}
+		else if (directive(line, "include", rest))
+		{
+			output.push_back(source.substr(segmentStart, lineStart - segmentStart));
+			size_t open = rest.find_first_of("\"<");
+			size_t close = open == std::string_view::npos ? open : rest.find_first_of("\">", open + 1);
+			if (close == std::string_view::npos)
+			{
+				std::cout << "ERROR::SHADER::BAD_INCLUDE " << path << ":" << lineNumber << std::endl;
+				ok = false;
+			}
+			else
+			{
+				std::string name(rest.substr(open + 1, close - open - 1));
+				Reach includeReach = reach();
+				if (includeReach != Skipped)
+					ok = append(directoryOf(path) + name, includeReach) && ok;
+				emit("#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n");
+			}
+			segmentStart = lineEnd;
+		}
+		else
+			conditional(line);
+		lineStart = lineEnd;
+		lineNumber++;
+	}
+	output.push_back(source.substr(segmentStart));
+	// keep the next file's first line on a line of its own
+	if (!source.empty() && source.back() != '\n')
+		emit("\n");
+	return ok;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#ifndef SHADERPREPROCESSOR_H
+#define SHADERPREPROCESSOR_H
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.h"
+
+// #define NAME VALUE pairs injected in front of a shader (value may be empty)
+typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
+// Where shader sources come from: memory-mapped files (each directory is
+// opened once and each file mapped once, however many programs include it) or
+// the tables built into the binary by tools/embed_shaders.cpp. Sources handed
+// out stay valid while the store lives.
+class ShaderFiles
+{
+public:
+	enum Origin { Disk, Embedded };
+	explicit ShaderFiles(Origin origin = Disk);
+
+	// false (and the error printed) when the file cannot be found
+	bool find(const std::string& path, std::string_view& source);
+	// development override for embedded sources: a file found under this
+	// directory replaces the embedded copy (PG_SHADER_DIR environment variable)
+	static std::string overrideDirectory();
+
+private:
+	Origin origin;
+
+	const MappedFile* map(const std::string& path, bool reportErrors);
+	std::map<std::string, std::unique_ptr<MappedDirectory>> directories;
+	std::map<std::string, std::unique_ptr<MappedFile>> files;
+};
+
+// Resolves #include "file" (relative to the including file, each file at most
+// once) and injects a define set right after #version. The result is a list of
+// slices of the mapped files handed to glShaderSource as-is, so the text is
+// never copied.
+// Includes follow the #ifdef/#ifndef/#else/#endif around them, evaluated
+// against the injected defines and the #define/#undef lines seen so far: one
+// in a block the compiler skips is not expanded, and does not count as the
+// file's one inclusion. #if/#elif expressions and the GL_ macros the compiler
+// predefines are not evaluated; a file included under them is expanded again
+// by a later include, so such files need include guards of their own.
+class ShaderPreprocessor
+{
+public:
+	// sorted "NAME=VALUE;" list: two programs built from the same files with the
+	// same key are the same variant
+	static std::string permutationKey(const ShaderDefines& defines);
+
+	// false (and prints the error) when a file cannot be read
+	bool process(ShaderFiles& sourceFiles, const std::string& path, const ShaderDefines& defines);
+	// slices of the preprocessed source, valid while this object and the store live
+	const std::vector<std::string_view>& segments() const { return output; }
+	// files in #line source-string order, to read compiler messages
+	const std::vector<std::string>& files() const { return fileNames; }
+
+private:
+	std::vector<std::string_view> output;
+	std::vector<std::string> fileNames;
+	// generated lines; a deque never moves its elements
+	std::deque<std::string> storage;
+	ShaderFiles* store = nullptr;
+	// defines not injected yet (waiting for #version)
+	const ShaderDefines* pendingDefines = nullptr;
+
+	// whether the text at a point of the expansion reaches the compiler
+	enum Reach { Compiled, Skipped, Unknown };
+	struct Conditional
+	{
+		Reach reach;
+		// an earlier branch of the block is compiled (or may be)
+		bool taken;
+		bool maybeTaken;
+	};
+	// #if blocks open at this point, outermost first
+	std::vector<Conditional> conditionals;
+	// macros known to be defined, and those whose state depends on an #if
+	std::set<std::string> defined;
+	std::set<std::string> uncertain;
+	// files included where they are known to be compiled
+	std::set<std::string> included;
+
+	bool append(const std::string& path, Reach inclusion);
+	// follows #ifdef/#ifndef/#if/#elif/#else/#endif and #define/#undef lines
+	void conditional(std::string_view line);
+	Reach reach() const;
+	Reach macroState(std::string_view name) const;
+	std::string defineLines(const ShaderDefines& defines) const;
+	void emit(std::string text);
+};
+#endif
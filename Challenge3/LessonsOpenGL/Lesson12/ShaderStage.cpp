@@ -0,0 +1,125 @@
+#include "ShaderStage.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+
+#include <glad/glad.h>
+#include <iostream>
+
+#include <glm/gtc/type_ptr.hpp>
+
+ShaderStage::ShaderStage(unsigned int type, const char* path, const ShaderDefines& defines)
+	: ID(0), type(type), valid(true), path(path)
+{
+	ShaderFiles files;
+	build(defines, files);
+}
+
+ShaderStage::ShaderStage(unsigned int type, const char* path, const ShaderDefines& defines, ShaderFiles& files)
+	: ID(0), type(type), valid(true), path(path)
+{
+	build(defines, files);
+}
+
+bool ShaderStage::isSupported()
+{
+	return (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_separate_shader_objects) &&
+		(GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_program_interface_query);
+}
+
+void ShaderStage::build(const ShaderDefines& defines, ShaderFiles& files)
+{
+	if (!isSupported())
+	{
+		std::cout << "ERROR::SHADER::STAGE::NOT_SUPPORTED (needs GL 4.3, or GL_ARB_separate_shader_objects and GL_ARB_program_interface_query)" << std::endl;
+		valid = false;
+		return;
+	}
+
+	// 1. map the source, with the includes resolved and the defines injected
+	ShaderPreprocessor source;
+	if (!source.process(files, path, defines))
+	{
+		std::cout << "ERROR::SHADER::STAGE::NOT_BUILT " << path << std::endl;
+		valid = false;
+		return;
+	}
+
+	// 2. a separable program holding just this stage, from the binary cache if possible;
+	// the stage type goes into the key, the same file could be built as another stage
+	ID = glCreateProgram();
+	glProgramParameteri(ID, GL_PROGRAM_SEPARABLE, GL_TRUE);
+	std::string key = ShaderCache::makeKey(source.segments(), { ShaderCompiler::stageName(type) });
+	if (!ShaderCache::load(ID, key))
+	{
+		unsigned int shader = ShaderCompiler::submitStage(type, source.segments());
+		valid = ShaderCompiler::checkStage(shader, type, source.files());
+		if (valid)
+		{
+			glAttachShader(ID, shader);
+			ShaderCompiler::submitLink(ID);
+			valid = ShaderCompiler::checkLink(ID, "STAGE", path, key);
+			glDetachShader(ID, shader);
+		}
+		glDeleteShader(shader);
+	}
+	if (!valid)
+		return;
+
+	// 3. shared blocks and the interface the other stages are matched against
+	ShaderCompiler::bindUniformBlocks(ID);
+	reflectInterface(GL_PROGRAM_INPUT, inputs);
+	reflectInterface(GL_PROGRAM_OUTPUT, outputs);
+}
+
+void ShaderStage::reflectInterface(unsigned int programInterface, std::vector<StageVariable>& variables)
+{
+	variables.clear();
+	int count = 0, maxLength = 0;
+	glGetProgramInterfaceiv(ID, programInterface, GL_ACTIVE_RESOURCES, &count);
+	glGetProgramInterfaceiv(ID, programInterface, GL_MAX_NAME_LENGTH, &maxLength);
+	std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+	const GLenum properties[] = { GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE };
+	for (int i = 0; i < count; i++)
+	{
+		int length = 0;
+		glGetProgramResourceName(ID, programInterface, i, (GLsizei)nameBuffer.size(), &length, nameBuffer.data());
+		std::string name(nameBuffer.data(), length);
+		// built-ins (gl_Position, gl_FragCoord...) are not part of the user interface
+		if (name.compare(0, 3, "gl_") == 0)
+			continue;
+
+		int values[3] = { 0, -1, 0 };
+		glGetProgramResourceiv(ID, programInterface, i, 3, properties, 3, NULL, values);
+		StageVariable variable;
+		variable.name = name;
+		variable.type = values[0];
+		variable.location = values[1];
+		variable.arraySize = values[2];
+		variables.push_back(variable);
+	}
+}
+
+void ShaderStage::setBool(const std::string& name, bool value) const
+{
+	glProgramUniform1i(ID, glGetUniformLocation(ID, name.c_str()), (int)value);
+}
+void ShaderStage::setInt(const std::string& name, int value) const
+{
+	glProgramUniform1i(ID, glGetUniformLocation(ID, name.c_str()), value);
+}
+void ShaderStage::setFloat(const std::string& name, float value) const
+{
+	glProgramUniform1f(ID, glGetUniformLocation(ID, name.c_str()), value);
+}
+void ShaderStage::setVec3(const std::string& name, const glm::vec3& value) const
+{
+	glProgramUniform3fv(ID, glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+void ShaderStage::setVec4(const std::string& name, const glm::vec4& value) const
+{
+	glProgramUniform4fv(ID, glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+void ShaderStage::setMat4(const std::string& name, const glm::mat4& value) const
+{
+	glProgramUniformMatrix4fv(ID, glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+}
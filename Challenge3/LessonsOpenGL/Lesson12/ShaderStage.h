@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef SHADERSTAGE_H
+#define SHADERSTAGE_H
+
+#include <string>
+#include <vector>
+
+#include "ShaderPreprocessor.h"
+
+#include <glm/glm.hpp>
+
+// one user-defined input or output of a stage, as reported by the program interface queries
+struct StageVariable
+{
+	std::string name;
+	unsigned int type;
+	// -1 unless declared with layout (location = n)
+	int location;
+	int arraySize;
+};
+
+// A single shader stage linked on its own as a separable program
+// (GL_ARB_separate_shader_objects). It is compiled once and can then be
+// combined with any stage whose interface matches (see ProgramPipeline).
+class ShaderStage
+{
+public:
+	// the separable program ID
+	unsigned int ID;
+	// GL_VERTEX_SHADER, GL_FRAGMENT_SHADER...
+	unsigned int type;
+	// reads, compiles and links the stage, with the includes and defines of the preprocessor
+	ShaderStage(unsigned int type, const char* path, const ShaderDefines& defines = ShaderDefines());
+	// same, mapping the source through a store shared with other stages
+	ShaderStage(unsigned int type, const char* path, const ShaderDefines& defines, ShaderFiles& files);
+	// false if the source could not be read or failed to compile/link
+	bool isValid() const { return valid; }
+	// GL 4.1 or GL_ARB_separate_shader_objects, plus the interface queries
+	// (GL 4.3 or GL_ARB_program_interface_query) used to match stages
+	static bool isSupported();
+	const std::string& getPath() const { return path; }
+	const std::vector<StageVariable>& getInputs() const { return inputs; }
+	const std::vector<StageVariable>& getOutputs() const { return outputs; }
+	// utility uniform functions; they use glProgramUniform*, so the stage
+	// does not have to be bound
+	void setBool(const std::string& name, bool value) const;
+	void setInt(const std::string& name, int value) const;
+	void setFloat(const std::string& name, float value) const;
+	void setVec3(const std::string& name, const glm::vec3& value) const;
+	void setVec4(const std::string& name, const glm::vec4& value) const;
+	void setMat4(const std::string& name, const glm::mat4& value) const;
+
+private:
+	bool valid;
+	std::string path;
+	std::vector<StageVariable> inputs;
+	std::vector<StageVariable> outputs;
+
+	void build(const ShaderDefines& defines, ShaderFiles& files);
+	void reflectInterface(unsigned int programInterface, std::vector<StageVariable>& variables);
+};
+#endif
@@ -0,0 +1,10 @@
+// The stb_image implementation. Everything it allocates goes through the
+// DecodeArena of the thread decoding (the streamer's workers have one each),
+// or to malloc on threads without one.
+#include "DecodeArena.h"
+
+#define STBI_MALLOC(size) DecodeArena::allocate(size)
+#define STBI_REALLOC_SIZED(block, oldSize, newSize) DecodeArena::reallocate(block, oldSize, newSize)
+#define STBI_FREE(block) DecodeArena::release(block)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
@@ -0,0 +1,66 @@
+#include "Texture.h"
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+Texture::~Texture()
+{
+	// until then ID is the streamer's placeholder, which is not ours to delete
+	if (resident)
+	{
+		GLState::forgetTexture(ID);
+		glDeleteTextures(1, &ID);
+	}
+}
+
+void Texture::makeResident(unsigned int texture, int textureWidth, int textureHeight, int channels, bool mipmaps)
+{
+	ID = texture;
+	width = textureWidth;
+	height = textureHeight;
+	resident = true;
+
+	// drivers pad RGB8 texels to 4 bytes
+	size_t texelBytes = channels == 3 ? 4 : channels;
+	bytes = 0;
+	for (int w = width, h = height; ; w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1)
+	{
+		bytes += (size_t)w * h * texelBytes;
+		if (!mipmaps || (w == 1 && h == 1))
+			break;
+	}
+}
+
+bool Texture::storageSupported()
+{
+	return GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage;
+}
+
+bool Texture::allocate(unsigned int internalFormat, unsigned int format, int levels, int levelWidth, int levelHeight)
+{
+	// without it, only the levels uploaded are used
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	if (storageSupported())
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, levelWidth, levelHeight);
+		return true;
+	}
+	if (format == 0)
+		return false;
+	for (int level = 0; level < levels; level++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelWidth, levelHeight, 0, format, GL_UNSIGNED_BYTE, NULL);
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+	return false;
+}
+
+void Texture::makeResident(unsigned int texture, int textureWidth, int textureHeight, size_t textureBytes)
+{
+	ID = texture;
+	width = textureWidth;
+	height = textureHeight;
+	bytes = textureBytes;
+	resident = true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <cstddef>
+
+// sampling parameters a texture is created with (GL enums)
+struct TextureParams
+{
+	int wrap;
+	int minFilter;
+	int magFilter;
+	bool mipmaps;
+};
+
+// A texture as the renderer sees it. ID can be bound at any time: it is a
+// shared placeholder until the image is resident, then the texture itself.
+// Textures are handed out as shared_ptr; the GL texture is deleted with the
+// last reference, so every holder must let go before the context goes away.
+struct Texture
+{
+	unsigned int ID = 0;
+	int width = 0;
+	int height = 0;
+	// estimated video memory, mip chain included
+	size_t bytes = 0;
+	// the image is uploaded and ID names it
+	bool resident = false;
+	// the image could not be read; ID stays the placeholder
+	bool failed = false;
+
+	Texture() = default;
+	~Texture();
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
+	// marks the texture resident as ID, with its video memory estimate
+	void makeResident(unsigned int texture, int width, int height, int channels, bool mipmaps);
+	// same, for a texture whose size is known exactly (compressed levels)
+	void makeResident(unsigned int texture, int width, int height, size_t bytes);
+
+	// allocates `levels` levels for the bound GL_TEXTURE_2D, to be filled with
+	// glTexSubImage2D: immutable storage (glTexStorage2D) where there is some,
+	// else every level with glTexImage2D. Compressed formats (format 0) are
+	// left for glCompressedTexImage2D without it. True if the storage is immutable
+	static bool allocate(unsigned int internalFormat, unsigned int format, int levels, int width, int height);
+	// immutable storage: GL 4.2 or GL_ARB_texture_storage
+	static bool storageSupported();
+};
+#endif
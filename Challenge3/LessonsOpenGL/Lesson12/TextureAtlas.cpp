@@ -0,0 +1,146 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace
+{
+	// cells start and end on 4 texel boundaries (also what block compression wants)
+	const int cellAlignment = 4;
+
+	int alignUp(int value)
+	{
+		return (value + cellAlignment - 1) / cellAlignment * cellAlignment;
+	}
+}
+
+TextureAtlas::TextureAtlas(int width, int height, int channels, int padding)
+	: width(width), height(height), channels(channels), padding(padding),
+	pixels((size_t)width * height * channels, 0), usedArea(0)
+{
+	skyline.push_back({ 0, 0, width });
+}
+
+int TextureAtlas::find(const std::string& name) const
+{
+	auto it = byName.find(name);
+	return it == byName.end() ? -1 : it->second;
+}
+
+float TextureAtlas::occupancy() const
+{
+	return (float)usedArea / ((float)width * height);
+}
+
+int TextureAtlas::add(const std::string& name, int imageWidth, int imageHeight, const unsigned char* image)
+{
+	// packing it again would orphan the first cell
+	int existing = find(name);
+	if (existing >= 0)
+		return existing;
+
+	AtlasEntry entry = { 0, 0, imageWidth, imageHeight, 0.0f, 0.0f, 0.0f, 0.0f };
+	if (imageWidth > 0 && imageHeight > 0)
+	{
+		int cellWidth = alignUp(imageWidth + 2 * padding);
+		int cellHeight = alignUp(imageHeight + 2 * padding);
+		int cellX, cellY;
+		if (!pack(cellWidth, cellHeight, cellX, cellY))
+			return -1;
+		usedArea += (size_t)cellWidth * cellHeight;
+		entry.x = cellX + padding;
+		entry.y = cellY + padding;
+
+		// the image, then its edges repeated over the gutter
+		size_t texel = channels;
+		for (int y = -padding; y < imageHeight + padding; y++)
+		{
+			int sourceY = std::min(std::max(y, 0), imageHeight - 1);
+			const unsigned char* sourceRow = image + (size_t)sourceY * imageWidth * texel;
+			unsigned char* row = &pixels[((size_t)(entry.y + y) * width + entry.x) * texel];
+			memcpy(row, sourceRow, imageWidth * texel);
+			for (int x = 1; x <= padding; x++)
+			{
+				memcpy(row - x * texel, sourceRow, texel);
+				memcpy(row + (imageWidth - 1 + x) * texel, sourceRow + (imageWidth - 1) * texel, texel);
+			}
+		}
+
+		entry.u0 = (float)entry.x / width;
+		entry.v0 = (float)entry.y / height;
+		entry.u1 = (float)(entry.x + imageWidth) / width;
+		entry.v1 = (float)(entry.y + imageHeight) / height;
+	}
+
+	int index = (int)entries.size();
+	entries.push_back(entry);
+	names.push_back(name);
+	byName[name] = index;
+	return index;
+}
+
+int TextureAtlas::fit(size_t segment, int cellWidth, int cellHeight) const
+{
+	// the cell rests on the highest segment under it
+	int x = skyline[segment].x;
+	if (x + cellWidth > width)
+		return -1;
+	int y = 0, left = cellWidth;
+	for (size_t i = segment; left > 0; i++)
+	{
+		y = std::max(y, skyline[i].y);
+		left -= skyline[i].width;
+	}
+	return y + cellHeight > height ? -1 : y;
+}
+
+bool TextureAtlas::pack(int cellWidth, int cellHeight, int& x, int& y)
+{
+	// bottom-left: lowest top edge, then the narrowest segment
+	size_t best = skyline.size();
+	int bestTop = INT_MAX, bestWidth = INT_MAX;
+	for (size_t i = 0; i < skyline.size(); i++)
+	{
+		int top = fit(i, cellWidth, cellHeight);
+		if (top < 0)
+			continue;
+		if (top + cellHeight < bestTop || (top + cellHeight == bestTop && skyline[i].width < bestWidth))
+		{
+			best = i;
+			bestTop = top + cellHeight;
+			bestWidth = skyline[i].width;
+		}
+	}
+	if (best == skyline.size())
+		return false;
+	x = skyline[best].x;
+	y = bestTop - cellHeight;
+
+	// the cell's top becomes a segment; the ones it covers shrink or go
+	skyline.insert(skyline.begin() + best, { x, bestTop, cellWidth });
+	for (size_t i = best + 1; i < skyline.size(); )
+	{
+		int covered = x + cellWidth - skyline[i].x;
+		if (covered <= 0)
+			break;
+		if (covered < skyline[i].width)
+		{
+			skyline[i].x += covered;
+			skyline[i].width -= covered;
+			break;
+		}
+		skyline.erase(skyline.begin() + i);
+	}
+	for (size_t i = 0; i + 1 < skyline.size(); )
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+			i++;
+	}
+	return true;
+}
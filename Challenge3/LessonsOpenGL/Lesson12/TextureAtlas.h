@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// where an image ended up: texels of the page, and the UV rectangle to sample
+// (v grows downwards, the way the rows are stored)
+struct AtlasEntry
+{
+	int x;
+	int y;
+	int width;
+	int height;
+	float u0;
+	float v0;
+	float u1;
+	float v1;
+};
+
+// Packs many small images into one page, so draws using any of them share a
+// single texture and can be batched. Images are placed by a skyline packer
+// (bottom-left fit) in cells aligned to 4 texels; each image is surrounded
+// by a gutter of `padding` texels repeating its edges, so bilinear filtering
+// and the first log2(padding) + 1 mip levels do not bleed neighbours in.
+// Only builds the pixels: upload them like any other image
+// (TextureManager::create), or save them (tools/atlas_builder).
+class TextureAtlas
+{
+public:
+	int width;
+	int height;
+	int channels;
+	int padding;
+	// the page, rows top to bottom, tightly packed
+	std::vector<unsigned char> pixels;
+
+	TextureAtlas(int width, int height, int channels, int padding = 2);
+
+	// copies an image (tightly packed, `channels` per texel) into the page;
+	// -1 if it does not fit. Empty images take no room. A name that was added
+	// before is not packed again: the index of its first image is returned
+	int add(const std::string& name, int imageWidth, int imageHeight, const unsigned char* image);
+	// index of an image added under that name, -1 if there is none
+	int find(const std::string& name) const;
+	const AtlasEntry& entry(int index) const { return entries[index]; }
+	size_t size() const { return entries.size(); }
+	const std::string& name(int index) const { return names[index]; }
+	// fraction of the page taken by cells
+	float occupancy() const;
+
+private:
+	// top of the packed area over [x, x + width)
+	struct Segment
+	{
+		int x;
+		int y;
+		int width;
+	};
+	std::vector<Segment> skyline;
+	std::vector<AtlasEntry> entries;
+	std::vector<std::string> names;
+	std::map<std::string, int> byName;
+	size_t usedArea;
+
+	bool pack(int cellWidth, int cellHeight, int& x, int& y);
+	int fit(size_t segment, int cellWidth, int cellHeight) const;
+};
+#endif
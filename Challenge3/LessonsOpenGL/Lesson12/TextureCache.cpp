@@ -0,0 +1,276 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+std::string TextureCache::directory = "cache/textures";
+std::atomic<unsigned int> TextureCache::hits(0);
+std::atomic<unsigned int> TextureCache::misses(0);
+
+namespace
+{
+	// header written in front of every blob, followed by one BlobLevel per
+	// level and the pixels of each level, 16-byte aligned
+	struct BlobHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t channels;
+		uint32_t levelCount;
+	};
+	struct BlobLevel
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+	};
+	const char blobMagic[4] = { 'P', 'G', 'T', 'X' };
+	const uint32_t blobVersion = 1;
+	// version of what produced the pixels: stb_image (with the decoder changes
+	// made to it here) and MipChain. Bump it when either changes its output, so
+	// the entries they wrote before are missed and replaced rather than served
+	const uint32_t decoderVersion = 1;
+	// larger than any level GL takes, small enough that sizes cannot overflow
+	const uint32_t maxSize = 1 << 16;
+
+	// 64-bit FNV-1a, as in ShaderCache, for the short fields
+	uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	const uint64_t prime1 = 11400714785074694791ull;
+	const uint64_t prime2 = 14029467366897019727ull;
+
+	uint64_t rotate(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	uint64_t mix(uint64_t lane, uint64_t word)
+	{
+		return rotate(lane + word * prime2, 31) * prime1;
+	}
+
+	// the files are hashed on every load, hit or miss: FNV-1a a byte at a time
+	// would take about as long as decoding a small PNG, so the bulk goes eight
+	// bytes at a time through four independent lanes (the xxHash64 round)
+	uint64_t contentHash(const unsigned char* data, size_t size)
+	{
+		uint64_t lanes[4] = { prime1 + prime2, prime2, 0, 0 - prime1 };
+		size_t at = 0;
+		for (; at + 32 <= size; at += 32)
+		{
+			for (int lane = 0; lane < 4; lane++)
+			{
+				uint64_t word;
+				memcpy(&word, data + at + lane * 8, 8);
+				lanes[lane] = mix(lanes[lane], word);
+			}
+		}
+		uint64_t hash = rotate(lanes[0], 1) + rotate(lanes[1], 7) + rotate(lanes[2], 12) + rotate(lanes[3], 18) + size;
+		for (; at < size; at++)
+			hash = mix(hash, data[at]);
+		// spread the last bytes over every bit
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		hash *= prime1;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	size_t alignUp(size_t offset)
+	{
+		return (offset + 15) & ~(size_t)15;
+	}
+
+	std::string blobPath(const std::string& key)
+	{
+		return TextureCache::directory + "/" + key + ".tex";
+	}
+}
+
+bool CachedImage::load(const std::string& path)
+{
+	file = std::make_unique<MappedFile>();
+	if (!file->open(path) || !parse())
+	{
+		file.reset();
+		levels.clear();
+		return false;
+	}
+	return true;
+}
+
+bool CachedImage::parse()
+{
+	size_t size = file->size();
+	BlobHeader header;
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, bytes(), sizeof(header));
+	if (memcmp(header.magic, blobMagic, sizeof(blobMagic)) != 0 || header.version != blobVersion ||
+		header.channels < 1 || header.channels > 4 || header.levelCount < 1 || header.levelCount > 32 ||
+		sizeof(header) + header.levelCount * sizeof(BlobLevel) > size)
+		return false;
+	width = (int)header.width;
+	height = (int)header.height;
+	channels = (int)header.channels;
+
+	levels.clear();
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		BlobLevel level;
+		memcpy(&level, bytes() + sizeof(header) + i * sizeof(BlobLevel), sizeof(level));
+		if (level.width < 1 || level.height < 1 || level.width > maxSize || level.height > maxSize ||
+			level.offset > size || (size_t)level.width * level.height * channels > size - level.offset)
+			return false;
+		levels.push_back({ (int)level.width, (int)level.height, (size_t)level.offset });
+	}
+	if (levels[0].width != width || levels[0].height != height)
+		return false;
+
+	// the chain glTexStorage2D is asked for: each level half the one above,
+	// and no more levels than halving down to 1x1 gives
+	if ((int)levels.size() > MipChain::levelCount(width, height))
+		return false;
+	for (size_t i = 1; i < levels.size(); i++)
+	{
+		if (levels[i].width != std::max(1, levels[i - 1].width / 2) ||
+			levels[i].height != std::max(1, levels[i - 1].height / 2))
+			return false;
+	}
+	return true;
+}
+
+std::string TextureCache::makeKey(const std::string& path, std::string_view contents, bool mipmaps)
+{
+	// the path and the load parameters name the entry, so storing new contents
+	// finds the old ones, and the same file loaded with other parameters is
+	// another entry rather than one they would take turns evicting
+	unsigned char flags = mipmaps ? 1 : 0;
+	uint64_t nameHash = fnv1a(14695981039346656037ull, path.data(), path.size());
+	nameHash = fnv1a(nameHash, &flags, 1);
+	uint64_t hash = contentHash(reinterpret_cast<const unsigned char*>(contents.data()), contents.size());
+	// the decoder is part of the contents half: a new one makes a new key under
+	// the same name, and storing it removes what the old decoder wrote
+	hash = fnv1a(hash, &decoderVersion, sizeof(decoderVersion));
+
+	char key[34];
+	snprintf(key, sizeof(key), "%016llx-%016llx", static_cast<unsigned long long>(nameHash),
+		static_cast<unsigned long long>(hash));
+	return key;
+}
+
+bool TextureCache::load(const std::string& key, CachedImage& image)
+{
+	std::string path = blobPath(key);
+	if (!image.load(path))
+	{
+		std::error_code ec;
+		if (std::filesystem::exists(path, ec))
+		{
+			// truncated, or written by another version: decode again and overwrite it
+			std::cout << "WARNING::TEXTURE::CACHE::BLOB_REJECTED " << key << std::endl;
+			std::filesystem::remove(path, ec);
+		}
+		misses++;
+		return false;
+	}
+	hits++;
+	return true;
+}
+
+void TextureCache::store(const std::string& key, const unsigned char* pixels, int width, int height, int channels, const MipChain& mips)
+{
+	BlobHeader header;
+	memcpy(header.magic, blobMagic, sizeof(blobMagic));
+	header.version = blobVersion;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.channels = (uint32_t)channels;
+	header.levelCount = (uint32_t)mips.levels.size() + 1;
+
+	std::vector<BlobLevel> levels;
+	std::vector<const unsigned char*> data;
+	size_t offset = alignUp(sizeof(header) + header.levelCount * sizeof(BlobLevel));
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		BlobLevel level;
+		level.width = i == 0 ? (uint32_t)width : (uint32_t)mips.levels[i - 1].width;
+		level.height = i == 0 ? (uint32_t)height : (uint32_t)mips.levels[i - 1].height;
+		level.offset = offset;
+		levels.push_back(level);
+		data.push_back(i == 0 ? pixels : mips.levelData(i - 1));
+		offset = alignUp(offset + (size_t)level.width * level.height * channels);
+	}
+
+	// written aside and renamed into place, so a worker loading the same key
+	// never maps a half-written blob
+	static std::atomic<unsigned int> writes(0);
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+	std::string path = blobPath(key);
+	std::string temporary = path + "." + std::to_string(writes++) + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		const char padding[16] = {};
+		bool ok = (bool)file.write(reinterpret_cast<const char*>(&header), sizeof(header)) &&
+			file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(BlobLevel));
+		size_t written = sizeof(header) + levels.size() * sizeof(BlobLevel);
+		for (size_t i = 0; ok && i < levels.size(); i++)
+		{
+			size_t bytes = (size_t)levels[i].width * levels[i].height * channels;
+			ok = file.write(padding, levels[i].offset - written) &&
+				file.write(reinterpret_cast<const char*>(data[i]), bytes);
+			written = levels[i].offset + bytes;
+		}
+		if (!ok || !file.flush())
+		{
+			std::cout << "ERROR::TEXTURE::CACHE::WRITE_FAILED " << path << std::endl;
+			file.close();
+			std::filesystem::remove(temporary, ec);
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, path, ec);
+	if (ec)
+	{
+		std::cout << "ERROR::TEXTURE::CACHE::WRITE_FAILED " << path << ": " << ec.message() << std::endl;
+		std::filesystem::remove(temporary, ec);
+		return;
+	}
+
+	// the file changed since its last entry: that one will never be hit again
+	std::string prefix = key.substr(0, key.find('-') + 1);
+	// this runs on the streaming workers: iterate with error codes, as the
+	// throwing operator++ would terminate the program if the directory changed
+	std::filesystem::directory_iterator it(directory, ec);
+	for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+	{
+		const std::filesystem::path& entry = it->path();
+		std::string name = entry.filename().string();
+		std::error_code removeError;
+		if (name.compare(0, prefix.size(), prefix) == 0 && entry.extension() == ".tex" && name != key + ".tex")
+			std::filesystem::remove(entry, removeError);
+	}
+}
+
+void TextureCache::printStats()
+{
+	std::cout << "TEXTURE::CACHE hits: " << hits << " misses: " << misses << std::endl;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include "MappedFile.h"
+#include "MipChain.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// one level of a cached image, the image itself included: a slice of the blob
+struct CachedLevel
+{
+	int width;
+	int height;
+	size_t offset;
+};
+
+// A decoded image and its mip chain as TextureCache wrote them. Like DdsImage
+// the blob is mapped, not read, and the levels point into the mapping: tightly
+// packed 8-bit rows, ready to be uploaded from the file's pages.
+class CachedImage
+{
+public:
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	std::vector<CachedLevel> levels;
+
+	// maps a blob; false if there is none or it is not one TextureCache wrote
+	bool load(const std::string& path);
+	bool loaded() const { return file != nullptr; }
+	const unsigned char* levelData(size_t level) const { return bytes() + levels[level].offset; }
+
+private:
+	std::unique_ptr<MappedFile> file;
+
+	const unsigned char* bytes() const { return reinterpret_cast<const unsigned char*>(file->data()); }
+	bool parse();
+};
+
+// On-disk cache of decoded textures, so an image is only decoded (and its mips
+// only built) the first time it is seen. Entries are keyed by a hash of the
+// path and the load parameters that change the pixels, plus a hash of the
+// source file's bytes and the decoder version: an edited file (or a changed
+// decoder) gets a new key, and storing it removes the old entry. Thread-safe: the streaming workers load and
+// store concurrently.
+class TextureCache
+{
+public:
+	// directory where the decoded blobs are written
+	static std::string directory;
+	// hit/miss counters since startup
+	static std::atomic<unsigned int> hits;
+	static std::atomic<unsigned int> misses;
+
+	// builds the cache key for the contents of the file at path
+	static std::string makeKey(const std::string& path, std::string_view contents, bool mipmaps);
+	// maps the cached blob into image; false (miss) if absent or invalid
+	static bool load(const std::string& key, CachedImage& image);
+	// saves a decoded image and its mips (mips.levels is empty without mipmaps)
+	static void store(const std::string& key, const unsigned char* pixels, int width, int height, int channels, const MipChain& mips);
+	// prints the hit/miss counters
+	static void printStats();
+};
+#endif
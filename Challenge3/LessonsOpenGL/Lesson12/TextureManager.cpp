@@ -0,0 +1,124 @@
+#include "TextureManager.h"
+#include "TextureStreamer.h"
+#include "GLState.h"
+#include "MipChain.h"
+
+#include <glad/glad.h>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+	const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	const GLenum internalFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+}
+
+TextureManager::TextureManager(TextureStreamer& streamer)
+	: reused(0), created(0), streamer(streamer)
+{
+}
+
+std::string TextureManager::makeKey(const std::string& name, const TextureParams& params)
+{
+	return name + "|" + std::to_string(params.wrap) + "," + std::to_string(params.minFilter) + "," +
+		std::to_string(params.magFilter) + "," + (params.mipmaps ? "mips" : "nomips");
+}
+
+std::shared_ptr<Texture> TextureManager::find(const std::string& key)
+{
+	auto entry = textures.find(key);
+	if (entry == textures.end())
+		return nullptr;
+	std::shared_ptr<Texture> texture = entry->second.lock();
+	if (!texture)
+	{
+		// released since: the slot is reused below
+		textures.erase(entry);
+		return nullptr;
+	}
+	reused++;
+	return texture;
+}
+
+std::shared_ptr<Texture> TextureManager::load(const std::string& path, const TextureParams& params)
+{
+	// "textures/wall.jpg" and "./textures/../textures/wall.jpg" are the same texture
+	std::error_code ec;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+	std::string key = makeKey(ec ? path : canonical.generic_string(), params);
+	std::shared_ptr<Texture> texture = find(key);
+	if (texture)
+		return texture;
+
+	texture = streamer.load(path, params);
+	textures[key] = texture;
+	created++;
+	return texture;
+}
+
+std::shared_ptr<Texture> TextureManager::create(const std::string& name, int width, int height, int channels,
+	const void* pixels, const TextureParams& params)
+{
+	std::string key = makeKey(name, params);
+	std::shared_ptr<Texture> texture = find(key);
+	if (texture)
+		return texture;
+
+	// the mips are built here, on the calling thread: these images are already in memory
+	MipChain mips;
+	if (params.mipmaps)
+	{
+		mips.build(static_cast<const unsigned char*>(pixels), width, height, channels);
+		std::cout << "TEXTURE::MIPS " << name << ": " << mips.levels.size() << " levels in " <<
+			mips.milliseconds << " ms" << std::endl;
+	}
+
+	unsigned int id;
+	glGenTextures(1, &id);
+	GLState::bindTexture(GL_TEXTURE_2D, id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+	Texture::allocate(internalFormats[channels - 1], formats[channels - 1], (int)mips.levels.size() + 1, width, height);
+	int alignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, formats[channels - 1], GL_UNSIGNED_BYTE, pixels);
+	for (size_t level = 0; level < mips.levels.size(); level++)
+	{
+		const MipLevel& mip = mips.levels[level];
+		glTexSubImage2D(GL_TEXTURE_2D, (GLint)level + 1, 0, 0, mip.width, mip.height, formats[channels - 1],
+			GL_UNSIGNED_BYTE, mips.levelData(level));
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+	texture = std::make_shared<Texture>();
+	texture->makeResident(id, width, height, channels, params.mipmaps);
+	textures[key] = texture;
+	created++;
+	return texture;
+}
+
+void TextureManager::report()
+{
+	size_t total = 0, live = 0;
+	for (auto entry = textures.begin(); entry != textures.end();)
+	{
+		std::shared_ptr<Texture> texture = entry->second.lock();
+		if (!texture)
+		{
+			entry = textures.erase(entry);
+			continue;
+		}
+		// the copy just made is not a holder
+		std::cout << "TEXTURE " << entry->first << " " << texture->width << "x" << texture->height <<
+			" refs: " << texture.use_count() - 1 << " bytes: " << texture->bytes <<
+			(texture->resident ? "" : texture->failed ? " (failed)" : " (streaming)") << std::endl;
+		total += texture->bytes;
+		live++;
+		++entry;
+	}
+	std::cout << "TEXTURE::MANAGER " << live << " textures, " << total / 1024 << " KB, created: " << created <<
+		" reused: " << reused << std::endl;
+}
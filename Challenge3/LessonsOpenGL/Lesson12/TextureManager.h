@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef TEXTUREMANAGER_H
+#define TEXTUREMANAGER_H
+
+#include "Texture.h"
+
+#include <map>
+#include <memory>
+#include <string>
+
+class TextureStreamer;
+
+// Hands out shared textures, keyed by canonical path plus sampling parameters:
+// asking again for a texture somebody still holds returns the same one without
+// loading the image again. The manager only keeps weak references, so a
+// texture is deleted as soon as its last holder lets go.
+class TextureManager
+{
+public:
+	// files are loaded through the streamer
+	explicit TextureManager(TextureStreamer& streamer);
+
+	// the texture for this file and these params, streamed in if nobody holds it
+	std::shared_ptr<Texture> load(const std::string& path, const TextureParams& params);
+	// a texture made from pixels in memory (glyphs...), shared under a name
+	std::shared_ptr<Texture> create(const std::string& name, int width, int height, int channels,
+		const void* pixels, const TextureParams& params);
+	// prints every live texture with its holders and estimated video memory
+	void report();
+
+	// requests answered with a texture already loaded vs. textures created
+	unsigned int reused;
+	unsigned int created;
+
+private:
+	TextureStreamer& streamer;
+	std::map<std::string, std::weak_ptr<Texture>> textures;
+
+	std::shared_ptr<Texture> find(const std::string& key);
+	static std::string makeKey(const std::string& name, const TextureParams& params);
+};
+#endif
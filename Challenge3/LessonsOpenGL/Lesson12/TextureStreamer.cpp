@@ -0,0 +1,448 @@
+#include "TextureStreamer.h"
+#include "GLState.h"
+#include "MappedFile.h"
+
+#include <glad/glad.h>
+#include <cstring>
+#include <iostream>
+
+#include "stb_image.h"
+
+namespace
+{
+	// pixel formats by channel count
+	const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	const GLenum internalFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+}
+
+TextureStreamer::TextureStreamer(int workerCount, int slotCount, size_t slotSize)
+	: uploadBudget(slotSize), stopping(false), outstanding(0), placeholder(0), ring(0), ringMemory(nullptr),
+	slotSize(slotSize), nextSlot(0)
+{
+	// what textures show until they are resident: 1x1 mid grey
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+	glGenTextures(1, &placeholder);
+	GLState::bindTexture(GL_TEXTURE_2D, placeholder);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	if (isSupported())
+	{
+		// mapped once for the whole run: no map/unmap per upload
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		size_t size = slotSize * slotCount;
+		glGenBuffers(1, &ring);
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+		ringMemory = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (!ringMemory)
+			std::cout << "ERROR::TEXTURE::STREAMER::RING_NOT_MAPPED" << std::endl;
+		for (int i = 0; i < slotCount; i++)
+			slots.push_back({ slotSize * i, nullptr });
+	}
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		arenas.push_back(std::make_unique<DecodeArena>());
+		workers.emplace_back(&TextureStreamer::work, this, arenas.back().get());
+	}
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	stopWorkers();
+	for (Decoded& image : decoded)
+		stbi_image_free(image.pixels);
+}
+
+bool TextureStreamer::isSupported()
+{
+	return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+}
+
+std::shared_ptr<Texture> TextureStreamer::load(const std::string& path, const TextureParams& params)
+{
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+	texture->ID = placeholder;
+	std::lock_guard<std::mutex> lock(mutex);
+	jobs.push_back({ path, params, texture });
+	outstanding++;
+	wake.notify_one();
+	return texture;
+}
+
+size_t TextureStreamer::pending() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return outstanding;
+}
+
+void TextureStreamer::work(DecodeArena* arena)
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		// the slow part, away from the GL thread
+		Decoded image;
+		image.pixels = nullptr;
+		image.channels = 0;
+		if (DdsImage::isDds(job.path))
+		{
+			// already compressed, mips included: only mapped, the levels are
+			// uploaded from the mapping
+			if (image.compressed.load(job.path))
+			{
+				image.width = image.compressed.width;
+				image.height = image.compressed.height;
+			}
+			else
+				std::cout << "ERROR::TEXTURE::LOAD_FAILED " << image.compressed.error() << std::endl;
+		}
+		else
+		{
+			// decoded straight from the mapped file, without copying it or going
+			// through stdio (and stb_image only spreads in-memory images over the DecodePool)
+			MappedFile file;
+			// whatever stb_image allocates comes from this worker's arena
+			DecodeArena::Scope scope(*arena);
+			if (!file.open(job.path))
+				std::cout << "ERROR::TEXTURE::LOAD_FAILED " << file.error() << std::endl;
+			else
+			{
+				file.adviseSequential();
+				// the same bytes were decoded before: their pixels and mips are mapped instead
+				std::string key = TextureCache::makeKey(job.path, file.view(), job.params.mipmaps);
+				if (TextureCache::load(key, image.cached))
+				{
+					image.width = image.cached.width;
+					image.height = image.cached.height;
+					image.channels = image.cached.channels;
+				}
+				else
+				{
+					image.pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data()), (int)file.size(),
+						&image.width, &image.height, &image.channels, 0);
+					if (!image.pixels)
+						std::cout << "ERROR::TEXTURE::LOAD_FAILED " << job.path << ": " << stbi_failure_reason() << std::endl;
+					else
+					{
+						if (job.params.mipmaps)
+							image.mips.build(image.pixels, image.width, image.height, image.channels);
+						TextureCache::store(key, image.pixels, image.width, image.height, image.channels, image.mips);
+					}
+				}
+			}
+		}
+		image.job = std::move(job);
+		image.texture = 0;
+		image.immutable = false;
+		image.nextLevel = 0;
+		image.nextRow = 0;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(std::move(image));
+		done.notify_all();
+	}
+}
+
+void TextureStreamer::update()
+{
+	upload(false);
+}
+
+void TextureStreamer::finish()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (outstanding > 0)
+	{
+		done.wait(lock, [this] { return !decoded.empty(); });
+		lock.unlock();
+		upload(true);
+		lock.lock();
+	}
+}
+
+void TextureStreamer::upload(bool block)
+{
+	size_t sent = 0;
+	for (;;)
+	{
+		Decoded* image;
+		{
+			// references to deque elements survive the workers' push_back
+			std::lock_guard<std::mutex> lock(mutex);
+			if (decoded.empty())
+				return;
+			image = &decoded.front();
+		}
+
+		bool compressed = image->compressed.format != 0;
+		if (compressed && !DdsImage::formatSupported(image->compressed.format))
+		{
+			std::cout << "ERROR::TEXTURE::FORMAT_NOT_SUPPORTED " << image->job.path << std::endl;
+			image->job.texture->failed = true;
+		}
+		else if (image->pixels || image->cached.loaded() || compressed)
+		{
+			size_t levels = compressed ? image->compressed.levels.size() :
+				image->cached.loaded() ? image->cached.levels.size() : image->mips.levels.size() + 1;
+			while (image->nextLevel < levels)
+			{
+				if (!block && sent >= uploadBudget)
+					return;
+				size_t bytes = compressed ? uploadLevel(*image, block) : uploadBand(*image, block);
+				// every slot is still in use by the GPU: carry on next frame
+				if (bytes == 0)
+					return;
+				sent += bytes;
+			}
+			complete(*image);
+		}
+		else
+		{
+			image->job.texture->failed = true;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.pop_front();
+		outstanding--;
+	}
+}
+
+void TextureStreamer::createTexture(Decoded& image)
+{
+	glGenTextures(1, &image.texture);
+	GLState::bindTexture(GL_TEXTURE_2D, image.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, image.job.params.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, image.job.params.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.job.params.minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, image.job.params.magFilter);
+	// the levels the file has are the whole chain, even if it stops before 1x1
+	if (image.compressed.format)
+		image.immutable = Texture::allocate(image.compressed.format, 0, (int)image.compressed.levels.size(), image.width, image.height);
+	else if (image.cached.loaded())
+		image.immutable = Texture::allocate(internalFormats[image.channels - 1], formats[image.channels - 1],
+			(int)image.cached.levels.size(), image.width, image.height);
+	else
+		image.immutable = Texture::allocate(internalFormats[image.channels - 1], formats[image.channels - 1],
+			(int)image.mips.levels.size() + 1, image.width, image.height);
+}
+
+TextureStreamer::Slot* TextureStreamer::acquireSlot(bool block)
+{
+	Slot& slot = slots[nextSlot];
+	if (slot.fence)
+	{
+		GLsync fence = (GLsync)slot.fence;
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (block && status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+		if (status == GL_TIMEOUT_EXPIRED)
+			return nullptr;
+		glDeleteSync(fence);
+		slot.fence = nullptr;
+	}
+	// the slot is free again once the GPU has read what is uploaded from it now
+	nextSlot = (nextSlot + 1) % slots.size();
+	return &slot;
+}
+
+size_t TextureStreamer::uploadBand(Decoded& image, bool block)
+{
+	GLenum format = formats[image.channels - 1];
+	if (image.texture == 0)
+		createTexture(image);
+	else
+		GLState::bindTexture(GL_TEXTURE_2D, image.texture);
+
+	// level 0 is the decoded image, the rest come from the worker's mip chain;
+	// a cached image has every level in the mapped blob
+	GLint level = (GLint)image.nextLevel;
+	int width = image.width, height = image.height;
+	const unsigned char* pixels = image.pixels;
+	if (image.cached.loaded())
+	{
+		const CachedLevel& cached = image.cached.levels[level];
+		width = cached.width;
+		height = cached.height;
+		pixels = image.cached.levelData(level);
+	}
+	else if (level > 0)
+	{
+		const MipLevel& mip = image.mips.levels[level - 1];
+		width = mip.width;
+		height = mip.height;
+		pixels = image.mips.levelData(level - 1);
+	}
+	size_t rowBytes = (size_t)width * image.channels;
+	int rows = height - image.nextRow;
+	const unsigned char* source = pixels + image.nextRow * rowBytes;
+	// stb_image rows are tightly packed
+	int alignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (!ringMemory || rowBytes > slotSize)
+	{
+		// no ring, or a row wider than a slot: straight from the decoded pixels
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, image.nextRow, width, rows, format, GL_UNSIGNED_BYTE, source);
+	}
+	else
+	{
+		Slot* slot = acquireSlot(block);
+		if (!slot)
+		{
+			glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+			return 0;
+		}
+
+		if ((size_t)rows * rowBytes > slotSize)
+			rows = (int)(slotSize / rowBytes);
+		memcpy(ringMemory + slot->offset, source, rows * rowBytes);
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, image.nextRow, width, rows, format, GL_UNSIGNED_BYTE, (void*)slot->offset);
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	image.nextRow += rows;
+	if (image.nextRow == height)
+	{
+		image.nextLevel++;
+		image.nextRow = 0;
+	}
+	return rows * rowBytes;
+}
+
+size_t TextureStreamer::uploadLevel(Decoded& image, bool block)
+{
+	if (image.texture == 0)
+		createTexture(image);
+	else
+		GLState::bindTexture(GL_TEXTURE_2D, image.texture);
+
+	const DdsLevel& level = image.compressed.levels[image.nextLevel];
+	const unsigned char* source = image.compressed.levelData(image.nextLevel);
+	GLint index = (GLint)image.nextLevel;
+	GLenum format = image.compressed.format;
+	// compressed levels cannot be split into bands: a level larger than a slot goes direct
+	bool ringed = ringMemory && level.size <= slotSize;
+	Slot* slot = nullptr;
+	if (ringed)
+	{
+		slot = acquireSlot(block);
+		if (!slot)
+			return 0;
+		memcpy(ringMemory + slot->offset, source, level.size);
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+		source = reinterpret_cast<const unsigned char*>(slot->offset);
+	}
+	if (image.immutable)
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, index, 0, 0, level.width, level.height, format, (GLsizei)level.size, source);
+	else
+		glCompressedTexImage2D(GL_TEXTURE_2D, index, format, level.width, level.height, 0, (GLsizei)level.size, source);
+	if (ringed)
+	{
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	image.nextLevel++;
+	return level.size;
+}
+
+void TextureStreamer::complete(Decoded& image)
+{
+	if (image.compressed.format)
+	{
+		// the mips came with the file
+		image.job.texture->makeResident(image.texture, image.width, image.height, image.compressed.size());
+		image.compressed = DdsImage();
+		return;
+	}
+
+	if (!image.mips.levels.empty())
+	{
+		std::cout << "TEXTURE::MIPS " << image.job.path << ": " << image.mips.levels.size() << " levels in " <<
+			image.mips.milliseconds << " ms" << std::endl;
+		image.mips = MipChain();
+	}
+	stbi_image_free(image.pixels);
+	image.pixels = nullptr;
+	image.cached = CachedImage();
+
+	image.job.texture->makeResident(image.texture, image.width, image.height, image.channels, image.job.params.mipmaps);
+}
+
+void TextureStreamer::stopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+void TextureStreamer::report() const
+{
+	for (size_t i = 0; i < arenas.size(); i++)
+	{
+		DecodeArenaStats stats = arenas[i]->stats();
+		std::cout << "TEXTURE::ARENA worker " << i << ": " << stats.images << " images, " <<
+			stats.allocations << " allocations, " << stats.reallocations << " reallocations (" <<
+			stats.grownInPlace << " in place), chunks: " << stats.chunksAllocated << " allocated, " <<
+			stats.chunksReused << " reused, " << stats.bytesHeld / 1024 << " KB held" << std::endl;
+	}
+}
+
+void TextureStreamer::shutdown()
+{
+	stopWorkers();
+	// textures still on their way: the half-uploaded ones are not owned by a Texture yet
+	jobs.clear();
+	for (Decoded& image : decoded)
+	{
+		stbi_image_free(image.pixels);
+		if (image.texture)
+		{
+			GLState::forgetTexture(image.texture);
+			glDeleteTextures(1, &image.texture);
+		}
+	}
+	decoded.clear();
+	outstanding = 0;
+	for (Slot& slot : slots)
+	{
+		if (slot.fence)
+			glDeleteSync((GLsync)slot.fence);
+		slot.fence = nullptr;
+	}
+	if (ring)
+	{
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &ring);
+		GLState::forgetBuffer(ring);
+		ring = 0;
+		ringMemory = nullptr;
+	}
+	GLState::forgetTexture(placeholder);
+	glDeleteTextures(1, &placeholder);
+	placeholder = 0;
+}
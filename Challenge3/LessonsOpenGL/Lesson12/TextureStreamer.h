@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include "DdsImage.h"
+#include "DecodeArena.h"
+#include "MipChain.h"
+#include "Texture.h"
+#include "TextureCache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads textures without stalling the render loop. Worker threads map the
+// files and decode the images from the mapping; the GL thread copies the pixels, a band of rows at a time, into a
+// ring of persistently mapped pixel buffers and uploads them from there, with
+// a fence per ring slot so a slot is only rewritten once the GPU is done with
+// it. Without GL_ARB_buffer_storage the decoded pixels are uploaded directly.
+// .dds files (tools/texconv) are not decoded at all: their compressed mip
+// levels go from the mapping through the same ring, one level at a time. The workers also build
+// the mip chain of the images they decode (MipChain), so textures go into
+// immutable storage level by level and the driver never generates mipmaps.
+// Each worker decodes into its own DecodeArena, kept from one image to the next.
+// Decoded images and their mips are kept in the TextureCache: the next run
+// maps them from there and uploads them like a .dds, without decoding.
+class TextureStreamer
+{
+public:
+	// workers decoding in parallel; the ring has slotCount slots of slotSize bytes
+	TextureStreamer(int workerCount = 2, int slotCount = 3, size_t slotSize = 4 << 20);
+	// joins the workers; GL objects are only freed by shutdown()
+	~TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// queues an image; the texture is a placeholder until update() makes it resident
+	std::shared_ptr<Texture> load(const std::string& path, const TextureParams& params);
+	// GL thread, once per frame: uploads what is decoded, up to uploadBudget
+	// bytes, and never waits for the GPU
+	void update();
+	// waits until every queued texture is resident (or failed)
+	void finish();
+	// textures queued and not resident yet
+	size_t pending() const;
+	// stops the workers, drops the queued textures and deletes the ring and the
+	// placeholder; resident textures go with their last reference
+	void shutdown();
+	// prints what the workers' decode arenas did
+	void report() const;
+	// persistently mapped buffers: GL 4.4 or GL_ARB_buffer_storage
+	static bool isSupported();
+
+	// bytes uploaded per update()
+	size_t uploadBudget;
+
+private:
+	struct Job
+	{
+		std::string path;
+		TextureParams params;
+		std::shared_ptr<Texture> texture;
+	};
+	// a decoded image and its mips, or a cached one (cached.loaded()), uploaded
+	// in bands of rows, or a compressed one (compressed.format != 0), uploaded
+	// a mip level at a time
+	struct Decoded
+	{
+		Job job;
+		unsigned char* pixels;
+		MipChain mips;
+		CachedImage cached;
+		DdsImage compressed;
+		int width;
+		int height;
+		int channels;
+		unsigned int texture;
+		bool immutable;
+		size_t nextLevel;
+		int nextRow;
+	};
+	struct Slot
+	{
+		size_t offset;
+		void* fence;
+	};
+
+	// jobs for the workers
+	std::deque<Job> jobs;
+	// decoded by the workers, waiting for the GL thread
+	std::deque<Decoded> decoded;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::vector<std::thread> workers;
+	// one per worker; they outlive the workers, the GL thread frees the pixels
+	std::vector<std::unique_ptr<DecodeArena>> arenas;
+	bool stopping;
+	size_t outstanding;
+
+	unsigned int placeholder;
+	unsigned int ring;
+	unsigned char* ringMemory;
+	size_t slotSize;
+	std::vector<Slot> slots;
+	size_t nextSlot;
+
+	void work(DecodeArena* arena);
+	void upload(bool block);
+	size_t uploadBand(Decoded& image, bool block);
+	size_t uploadLevel(Decoded& image, bool block);
+	void createTexture(Decoded& image);
+	Slot* acquireSlot(bool block);
+	void complete(Decoded& image);
+	void stopWorkers();
+};
+#endif
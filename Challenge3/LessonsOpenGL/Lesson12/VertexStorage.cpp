@@ -0,0 +1,55 @@
+#include "VertexStorage.h"
+#include "GLState.h"
+
+#include <glad/glad.h>
+#include <cstddef>
+
+VertexStorage::VertexStorage()
+{
+	glGenBuffers(1, &vertexBuffer);
+	glGenBuffers(1, &meshBuffer);
+	// core profiles do not draw without a VAO, even one with no attributes
+	glGenVertexArrays(1, &vao);
+}
+
+bool VertexStorage::isSupported()
+{
+	return GLAD_GL_VERSION_4_3;
+}
+
+PulledMesh VertexStorage::add(const float* data, int vertexCount, const VertexLayout& layout)
+{
+	PulledMesh mesh;
+	mesh.index = (int)meshes.size() / 4;
+	mesh.vertexCount = vertexCount;
+	meshes.push_back((int)vertices.size());
+	meshes.push_back(layout.stride);
+	meshes.push_back(layout.position);
+	meshes.push_back(layout.texCoord);
+	vertices.insert(vertices.end(), data, data + (size_t)vertexCount * layout.stride);
+	return mesh;
+}
+
+void VertexStorage::upload()
+{
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, vertexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, meshBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, meshes.size() * sizeof(int), meshes.data(), GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void VertexStorage::bind()
+{
+	GLState::bindVertexArray(vao);
+	for (const BufferBinding& binding : bindings())
+		GLState::bindBufferBase(binding.target, binding.index, binding.buffer);
+}
+
+std::vector<BufferBinding> VertexStorage::bindings() const
+{
+	return {
+		{ GL_SHADER_STORAGE_BUFFER, vertexBinding, vertexBuffer },
+		{ GL_SHADER_STORAGE_BUFFER, meshBinding, meshBuffer },
+	};
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#ifndef VERTEXSTORAGE_H
+#define VERTEXSTORAGE_H
+
+#include "GLState.h"
+
+#include <vector>
+
+// where each attribute sits in a vertex, in floats; -1 for attributes the mesh does not have
+struct VertexLayout
+{
+	int stride;
+	int position;
+	int texCoord;
+};
+
+// a mesh inside VertexStorage: the value of the "mesh" uniform and the vertex count to draw
+struct PulledMesh
+{
+	int index;
+	int vertexCount;
+};
+
+// Programmable vertex pulling: the vertices of every mesh, whatever their
+// layout, go into one shader storage buffer, next to a table describing each
+// mesh, and the vertex shader fetches them by gl_VertexID (res/cube_pulled.vs).
+// A single empty VAO serves every draw, so meshes with different layouts no
+// longer need VAO switches.
+class VertexStorage
+{
+public:
+	// SSBO binding points, as declared in the pulling shaders
+	static const unsigned int vertexBinding = 1;
+	static const unsigned int meshBinding = 2;
+
+	// the buffer IDs and the empty VAO
+	unsigned int vertexBuffer;
+	unsigned int meshBuffer;
+	unsigned int vao;
+	VertexStorage();
+	// GL 4.3: shader storage buffers, and the #version 430 pulling shaders
+	static bool isSupported();
+	// copies the mesh into the storage; upload() sends everything added so far
+	PulledMesh add(const float* vertices, int vertexCount, const VertexLayout& layout);
+	void upload();
+	// binds the empty VAO and the buffers; then set "mesh" and glDrawArrays(mode, 0, vertexCount)
+	void bind();
+	// the buffers bind() puts on their binding points
+	std::vector<BufferBinding> bindings() const;
+
+private:
+	std::vector<float> vertices;
+	// first float, stride, position and texCoord offsets: an ivec4 per mesh
+	std::vector<int> meshes;
+};
+#endif
@@ -0,0 +1,18 @@
+#version 330 core
+// generated by tools/hoist_uniforms from cube.vs: products computed once per draw on the CPU
+uniform mat4 projection_view_model;
+layout (location = 0) in vec3 aPos;		// position has attribute position 0
+layout (location = 1) in vec2 aTexCoord;
+
+out vec2 TexCoords;
+
+
+uniform mat4 model;
+
+#include "framedata.glsl"
+
+void main()
+{
+	gl_Position = projection_view_model * vec4(aPos, 1.0f);
+	TexCoords = vec2(aTexCoord.x, aTexCoord.y);
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;		// position has attribute position 0
+layout (location = 1) in vec2 aTexCoord;
+
+out vec2 TexCoords;
+
+
+uniform mat4 model;
+
+#include "framedata.glsl"
+
+void main()
+{
+	gl_Position = projection * view * model * vec4(aPos, 1.0f);
+	TexCoords = vec2(aTexCoord.x, aTexCoord.y);
+}
\ No newline at end of file
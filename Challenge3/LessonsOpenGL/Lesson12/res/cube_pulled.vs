@@ -0,0 +1,30 @@
+#version 430 core
+// vertex pulling (VertexStorage.h): no attributes, every mesh is read from
+// the storage buffers by gl_VertexID, whatever its layout
+layout (std430, binding = 1) readonly buffer Vertices
+{
+	float vertices[];
+};
+// per mesh: first float, stride, position and texture coordinate offsets (-1 if absent)
+layout (std430, binding = 2) readonly buffer Meshes
+{
+	ivec4 meshes[];
+};
+
+out vec2 TexCoords;
+
+
+uniform mat4 model;
+uniform int mesh;
+
+#include "framedata.glsl"
+
+void main()
+{
+	ivec4 m = meshes[mesh];
+	int first = m.x + gl_VertexID * m.y;
+	vec3 aPos = vec3(vertices[first + m.z], vertices[first + m.z + 1], vertices[first + m.z + 2]);
+	vec2 aTexCoord = m.w >= 0 ? vec2(vertices[first + m.w], vertices[first + m.w + 1]) : vec2(0.0);
+	gl_Position = projection * view * model * vec4(aPos, 1.0f);
+	TexCoords = aTexCoord;
+}
\ No newline at end of file
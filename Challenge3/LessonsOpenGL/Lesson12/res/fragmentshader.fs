@@ -1,10 +1,17 @@
 #version 330 core
 in vec2 TexCoords;
 out vec4 color;
-uniform sampler2D text;
+uniform sampler2D image;
+#ifdef TEXT
+// glyph coverage is in the red channel
 uniform vec3 textColor;
+#endif
 void main()
 {
-vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
+#ifdef TEXT
+vec4 sampled = vec4(1.0, 1.0, 1.0, texture(image, TexCoords).r);
 color = vec4(textColor, 1.0) * sampled;
+#else
+color = texture(image, TexCoords);
+#endif
 }
\ No newline at end of file
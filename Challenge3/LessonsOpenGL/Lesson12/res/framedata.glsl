@@ -0,0 +1,7 @@
+// camera data shared by every program, uploaded once per frame (FrameData.h)
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 screen;
+};
\ No newline at end of file
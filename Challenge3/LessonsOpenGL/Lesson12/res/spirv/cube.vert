@@ -0,0 +1,25 @@
+// SPIR-V version of cube.vs, built with
+//   glslangValidator -G -o res/spirv/cube.vert.spv res/spirv/cube.vert
+// everything has an explicit location or binding: SPIR-V programs are not
+// matched by name
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+layout (location = 0) out vec2 TexCoords;
+
+layout (location = 0) uniform mat4 model;
+
+// same block as framedata.glsl, at FrameUniforms::binding
+layout (std140, binding = 0) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 screen;
+};
+
+void main()
+{
+	gl_Position = projection * view * model * vec4(aPos, 1.0f);
+	TexCoords = aTexCoord;
+}
@@ -0,0 +1,20 @@
+// SPIR-V version of vertexshader.vs, built with
+//   glslangValidator -G -o res/spirv/text.vert.spv res/spirv/text.vert
+#version 460 core
+layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
+
+layout (location = 0) out vec2 TexCoords;
+
+// same block as framedata.glsl, at FrameUniforms::binding
+layout (std140, binding = 0) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 screen;
+};
+
+void main()
+{
+	gl_Position = screen * vec4(vertex.xy, 0.0, 1.0);
+	TexCoords = vertex.zw;
+}
@@ -0,0 +1,25 @@
+// SPIR-V version of fragmentshader.fs, built with
+//   glslangValidator -G -o res/spirv/unlit.frag.spv res/spirv/unlit.frag
+// TEXT is a specialization constant: one module, both variants, and the
+// branch is folded away when the driver specializes it
+#version 460 core
+layout (constant_id = 0) const bool TEXT = false;
+
+layout (location = 0) in vec2 TexCoords;
+
+layout (location = 0) out vec4 color;
+
+layout (binding = 0) uniform sampler2D image;
+// glyph coverage is in the red channel
+layout (location = 1) uniform vec3 textColor;
+
+void main()
+{
+	if (TEXT)
+	{
+		vec4 sampled = vec4(1.0, 1.0, 1.0, texture(image, TexCoords).r);
+		color = vec4(textColor, 1.0) * sampled;
+	}
+	else
+		color = texture(image, TexCoords);
+}
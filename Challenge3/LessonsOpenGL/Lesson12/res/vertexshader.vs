@@ -1,9 +1,9 @@
 #version 330 core
 layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
 out vec2 TexCoords;
-uniform mat4 projection;
+#include "framedata.glsl"
 void main()
 {
-gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+gl_Position = screen * vec4(vertex.xy, 0.0, 1.0);
 TexCoords = vertex.zw;
 }
\ No newline at end of file
@@ -268,6 +268,11 @@ RECENT REVISION HISTORY:
 // (at least this is true for iOS and Android). Therefore, the NEON support is
 // toggled by a build flag: define STBI_NEON to get NEON loops.
 //
+// The JPEG upsampler and color converter also have AVX2 versions; they are
+// compiled for AVX2 alone and only used if a run-time test finds it, so the
+// rest of the code still runs on any SSE2 machine. They give exactly the
+// same pixels as the SSE2 ones. Define STBI_NO_AVX2 to leave them out.
+//
 // If for some reason you do not want to use any of SIMD code, or if
 // you have issues compiling it, you can disable it entirely by
 // defining STBI_NO_SIMD.
@@ -522,6 +527,16 @@ STBIDEF void stbi_set_unpremultiply_on_load_thread(int flag_true_if_should_unpre
 STBIDEF void stbi_convert_iphone_png_to_rgb_thread(int flag_true_if_should_convert);
 STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
 
+// parallel decoding: stb_image creates no threads itself. Given a function
+// that calls task(task_user, i) for every i in [0, count), spread over
+// threads, and returns once all calls are done, baseline JPEGs with restart
+// intervals decode their intervals in parallel, and JPEG color conversion
+// runs in bands of rows. The output is the same as without it. Only images
+// decoded from memory (stbi_load_from_memory) use it; NULL turns it off
+typedef void stbi_parallel_task(void *task_user, int index);
+typedef void stbi_parallel_for(stbi_parallel_task *task, void *task_user, int count, void *user);
+STBIDEF void stbi_set_parallel_for(stbi_parallel_for *parallel_for, void *user);
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -748,7 +763,7 @@ static int stbi__cpuid3(void)
 
 #define STBI_SIMD_ALIGN(type, name) __declspec(align(16)) type name
 
-#if !defined(STBI_NO_JPEG) && defined(STBI_SSE2)
+#if (!defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)) && defined(STBI_SSE2)
 static int stbi__sse2_available(void)
 {
    int info3 = stbi__cpuid3();
@@ -759,7 +774,7 @@ static int stbi__sse2_available(void)
 #else // assume GCC-style if not VC++
 #define STBI_SIMD_ALIGN(type, name) type name __attribute__((aligned(16)))
 
-#if !defined(STBI_NO_JPEG) && defined(STBI_SSE2)
+#if (!defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)) && defined(STBI_SSE2)
 static int stbi__sse2_available(void)
 {
    // If we're even attempting to compile this on GCC/Clang, that means
@@ -769,9 +784,57 @@ static int stbi__sse2_available(void)
 }
 #endif
 
+#endif
+
+// AVX2 kernels are built with a per-function target, so the compiler has to
+// allow AVX2 intrinsics in an SSE2 build (VC++ 2012, GCC 4.9, clang)
+#if !defined(STBI_NO_AVX2) && !defined(STBI_NO_JPEG)
+#if defined(_MSC_VER)
+#if _MSC_VER >= 1700
+#define STBI_AVX2
+#endif
+#elif defined(__clang__)
+#define STBI_AVX2
+#elif defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define STBI_AVX2
+#endif
+#endif
+
+#ifdef STBI_AVX2
+#include <immintrin.h>
+
+// set to use the SSE2 kernels even if AVX2 is there (to compare them)
+static int stbi__avx2_disabled = 0;
+
+#ifdef _MSC_VER
+#define STBI__AVX2_TARGET
+
+static int stbi__avx2_available(void)
+{
+   int info[4];
+   if (stbi__avx2_disabled) return 0;
+   __cpuid(info,1);
+   // the OS has to save the ymm registers (OSXSAVE, AVX, XCR0 bits 1 and 2)
+   if ((info[2] & (3 << 27)) != (3 << 27)) return 0;
+   if ((_xgetbv(0) & 6) != 6) return 0;
+   __cpuidex(info,7,0);
+   return ((info[1] >> 5) & 1) != 0;
+}
+#else
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+
+static int stbi__avx2_available(void)
+{
+   if (stbi__avx2_disabled) return 0;
+   // also checks the OS saves the ymm registers
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") != 0;
+}
 #endif
 #endif
 
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -1132,6 +1195,15 @@ STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_fli
                                          : stbi__vertically_flip_on_load_global)
 #endif // STBI_THREAD_LOCAL
 
+static stbi_parallel_for *stbi__parallel_for = NULL;
+static void *stbi__parallel_for_user = NULL;
+
+STBIDEF void stbi_set_parallel_for(stbi_parallel_for *parallel_for, void *user)
+{
+   stbi__parallel_for = parallel_for;
+   stbi__parallel_for_user = user;
+}
+
 static void *stbi__load_main(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri, int bpc)
 {
    memset(ri, 0, sizeof(*ri)); // make sure it's initialized if we add new fields
@@ -2944,9 +3016,138 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
+// decode MCU number 'mcu' (in scan order) of a baseline scan; for a
+// non-interleaved scan, every block is an MCU
+static int stbi__jpeg_decode_baseline_mcu(stbi__jpeg *z, int mcu)
+{
+   STBI_SIMD_ALIGN(short, data[64]);
+   if (z->scan_n == 1) {
+      int n = z->order[0];
+      int w = (z->img_comp[n].x+7) >> 3;
+      int i = mcu % w, j = mcu / w;
+      int ha = z->img_comp[n].ha;
+      if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+      z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+   } else {
+      int i = mcu % z->img_mcu_x, j = mcu / z->img_mcu_x;
+      int k,x,y;
+      for (k=0; k < z->scan_n; ++k) {
+         int n = z->order[k];
+         for (y=0; y < z->img_comp[n].v; ++y) {
+            for (x=0; x < z->img_comp[n].h; ++x) {
+               int x2 = (i*z->img_comp[n].h + x)*8;
+               int y2 = (j*z->img_comp[n].v + y)*8;
+               int ha = z->img_comp[n].ha;
+               if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+            }
+         }
+      }
+   }
+   return 1;
+}
+
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi_uc **starts; // first byte of each interval; starts[count] is the end of the scan
+   int count;
+   int mcus;
+   int *failed;
+} stbi__jpeg_intervals;
+
+// one restart interval, with its own copy of the decoder state
+static void stbi__jpeg_decode_interval(void *task_user, int index)
+{
+   stbi__jpeg_intervals *job = (stbi__jpeg_intervals *) task_user;
+   stbi__context s;
+   stbi__jpeg *z = (stbi__jpeg *) stbi__malloc(sizeof(stbi__jpeg));
+   int mcu = index * job->z->restart_interval;
+   int last = mcu + job->z->restart_interval;
+   if (last > job->mcus) last = job->mcus;
+   if (!z) { job->failed[index] = 1; return; }
+   memcpy(z, job->z, sizeof(stbi__jpeg));
+   stbi__start_mem(&s, job->starts[index], (int) (job->starts[job->count] - job->starts[index]));
+   z->s = &s;
+   stbi__jpeg_reset(z);
+   for (; mcu < last; ++mcu) {
+      if (!stbi__jpeg_decode_baseline_mcu(z, mcu)) {
+         job->failed[index] = 1;
+         break;
+      }
+   }
+   STBI_FREE(z);
+}
+
+// restart intervals are byte aligned and reset the entropy decoder and the
+// dc prediction, so once the RSTn markers are found they decode independently.
+// returns -1 if the scan does not qualify (or the markers do not add up), and
+// the serial decoder should take it
+static int stbi__parse_entropy_coded_data_parallel(stbi__jpeg *z)
+{
+   stbi__jpeg_intervals job;
+   stbi_uc *p, *end;
+   int i, expected, ok = 1;
+
+   if (!stbi__parallel_for || z->progressive || !z->restart_interval || z->s->read_from_callbacks)
+      return -1;
+   if (z->scan_n == 1) {
+      int n = z->order[0];
+      job.mcus = ((z->img_comp[n].x+7) >> 3) * ((z->img_comp[n].y+7) >> 3);
+   } else
+      job.mcus = z->img_mcu_x * z->img_mcu_y;
+   expected = (job.mcus + z->restart_interval - 1) / z->restart_interval;
+   if (expected < 2)
+      return -1;
+
+   job.starts = (stbi_uc **) stbi__malloc(sizeof(stbi_uc *) * (expected + 1));
+   job.failed = (int *) stbi__malloc(sizeof(int) * expected);
+   if (!job.starts || !job.failed) {
+      STBI_FREE(job.starts);
+      STBI_FREE(job.failed);
+      return -1;
+   }
+   job.z = z;
+   job.count = 0;
+   job.starts[job.count++] = z->s->img_buffer;
+   end = z->s->img_buffer_end;
+   for (p = z->s->img_buffer; p + 1 < z->s->img_buffer_end; ++p) {
+      if (p[0] != 0xff || p[1] == 0xff) continue; // data, or fill bytes before a marker
+      if (p[1] == 0x00) { ++p; continue; }       // stuffed zero
+      if (!STBI__RESTART(p[1])) { end = p; break; }
+      if (job.count == expected) { job.count = 0; break; }
+      job.starts[job.count++] = p + 2;
+      ++p;
+   }
+   if (job.count != expected) {
+      STBI_FREE(job.starts);
+      STBI_FREE(job.failed);
+      return -1;
+   }
+   job.starts[job.count] = end;
+   memset(job.failed, 0, sizeof(int) * expected);
+
+   stbi__parallel_for(stbi__jpeg_decode_interval, &job, job.count, stbi__parallel_for_user);
+
+   for (i=0; i < job.count; ++i)
+      if (job.failed[i]) ok = 0;
+   STBI_FREE(job.starts);
+   STBI_FREE(job.failed);
+   if (!ok) return stbi__err("bad huffman code","Corrupt JPEG");
+
+   // carry on from the marker ending the scan, as the serial decoder would
+   z->s->img_buffer = end;
+   stbi__jpeg_reset(z);
+   return 1;
+}
+
 static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
 {
    stbi__jpeg_reset(z);
+   {
+      int parallel = stbi__parse_entropy_coded_data_parallel(z);
+      if (parallel >= 0) return parallel;
+   }
    if (!z->progressive) {
       if (z->scan_n == 1) {
          int i,j;
@@ -3641,6 +3842,80 @@ static stbi_uc *stbi__resample_row_hv_2_simd(stbi_uc *out, stbi_uc *in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+// the SSE2 kernel, 16 pixels at a time
+STBI__AVX2_TARGET
+static stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   for (; i < ((w-1) & ~15); i += 16) {
+      // vertical pass, 3*x + y = 4*x + (y - x)
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i diff  = _mm256_sub_epi16(farw, nearw);
+      __m256i nears = _mm256_slli_epi16(nearw, 2);
+      __m256i curr  = _mm256_add_epi16(nears, diff); // current row
+
+      // "prev" and "next" are the current row shifted by one pixel. byte
+      // shifts don't cross the 128-bit lanes, so each one is an alignr against
+      // the row moved by a lane, with t1 and the first pixel of the next block
+      // of 16 in the slots that were empty
+      __m128i prvl  = _mm_insert_epi16(_mm_setzero_si128(), t1, 7);
+      __m128i nxtl  = _mm_insert_epi16(_mm_setzero_si128(), 3*in_near[i+16] + in_far[i+16], 0);
+      __m256i lower = _mm256_inserti128_si256(_mm256_castsi128_si256(prvl), _mm256_castsi256_si128(curr), 1);
+      __m256i upper = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_extracti128_si256(curr, 1)), nxtl, 1);
+      __m256i prev  = _mm256_alignr_epi8(curr, lower, 14);
+      __m256i next  = _mm256_alignr_epi8(upper, curr, 2);
+
+      // horizontal filter, polyphase:
+      // even pixels = 3*cur + prev = cur*4 + (prev - cur)
+      // odd  pixels = 3*cur + next = cur*4 + (next - cur)
+      __m256i bias  = _mm256_set1_epi16(8);
+      __m256i curs = _mm256_slli_epi16(curr, 2);
+      __m256i prvd = _mm256_sub_epi16(prev, curr);
+      __m256i nxtd = _mm256_sub_epi16(next, curr);
+      __m256i curb = _mm256_add_epi16(curs, bias);
+      __m256i even = _mm256_add_epi16(prvd, curb);
+      __m256i odd  = _mm256_add_epi16(nxtd, curb);
+
+      // interleave even and odd pixels and undo scaling. per lane, so the
+      // pack puts output pixels 0-15 in the low lane and 16-31 in the high one
+      __m256i int0 = _mm256_unpacklo_epi16(even, odd);
+      __m256i int1 = _mm256_unpackhi_epi16(even, odd);
+      __m256i de0  = _mm256_srli_epi16(int0, 4);
+      __m256i de1  = _mm256_srli_epi16(int1, 4);
+      __m256i outv = _mm256_packus_epi16(de0, de1);
+      _mm256_storeu_si256((__m256i *) (out + i*2), outv);
+
+      // "previous" value for next iter
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+#endif
+
 static stbi_uc *stbi__resample_row_generic(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
 {
    // resample with nearest-neighbor
@@ -3815,6 +4090,88 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+// the SSE2 kernel, 16 pixels at a time. 3 channel output is accelerated
+// too, since that's what textures load as: the 4 channel pixels are packed
+// with a shuffle and written with overlapping stores, which run 4 bytes
+// past the 16 pixels, so there have to be 2 more pixels left in the row
+STBI__AVX2_TARGET
+static void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 4 || step == 3) {
+      __m128i signflip  = _mm_set1_epi8(-0x80);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi16(8);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+      __m128i pack3 = _mm_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1);
+      int last = step == 4 ? 15 : 17;
+
+      for (; i+last < count; i += 16) {
+         // load
+         __m128i y_bytes = _mm_loadu_si128((__m128i *) (y+i));
+         __m128i cr_biased = _mm_xor_si128(_mm_loadu_si128((__m128i *) (pcr+i)), signflip); // -128
+         __m128i cb_biased = _mm_xor_si128(_mm_loadu_si128((__m128i *) (pcb+i)), signflip); // -128
+
+         // widen to short: y*16 + 8 is the SSE2 kernel's (y*256 + 128) >> 4,
+         // cr and cb are left-shifted by 8 the same way
+         __m256i yws = _mm256_add_epi16(_mm256_slli_epi16(_mm256_cvtepu8_epi16(y_bytes), 4), y_bias);
+         __m256i crw = _mm256_slli_epi16(_mm256_cvtepi8_epi16(cr_biased), 8);
+         __m256i cbw = _mm256_slli_epi16(_mm256_cvtepi8_epi16(cb_biased), 8);
+
+         // color transform
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte and transpose, per 128-bit lane: o0 gets pixels 0-3
+         // and 8-11, o1 pixels 4-7 and 12-15
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+         __m128i p0 = _mm256_castsi256_si128(o0);
+         __m128i p1 = _mm256_castsi256_si128(o1);
+         __m128i p2 = _mm256_extracti128_si256(o0, 1);
+         __m128i p3 = _mm256_extracti128_si256(o1, 1);
+
+         // store
+         if (step == 4) {
+            _mm_storeu_si128((__m128i *) (out +  0), p0);
+            _mm_storeu_si128((__m128i *) (out + 16), p1);
+            _mm_storeu_si128((__m128i *) (out + 32), p2);
+            _mm_storeu_si128((__m128i *) (out + 48), p3);
+         } else {
+            _mm_storeu_si128((__m128i *) (out +  0), _mm_shuffle_epi8(p0, pack3));
+            _mm_storeu_si128((__m128i *) (out + 12), _mm_shuffle_epi8(p1, pack3));
+            _mm_storeu_si128((__m128i *) (out + 24), _mm_shuffle_epi8(p2, pack3));
+            _mm_storeu_si128((__m128i *) (out + 36), _mm_shuffle_epi8(p3, pack3));
+         }
+         out += 16*step;
+      }
+   }
+
+   // the rest of the row
+   stbi__YCbCr_to_RGB_simd(out, y+i, pcb+i, pcr+i, count-i, step);
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
@@ -3830,6 +4187,14 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
    }
 #endif
 
+#ifdef STBI_AVX2
+   // there's no AVX2 IDCT: a block is 8 columns of shorts, which fits SSE2
+   if (stbi__avx2_available()) {
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+   }
+#endif
+
 #ifdef STBI_NEON
    j->idct_block_kernel = stbi__idct_simd;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
@@ -3860,6 +4225,147 @@ static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
    return (stbi_uc) ((t + (t >>8)) >> 8);
 }
 
+// resample and color-convert output rows [first, last); res_comp is the
+// resampler state at row 0, and is stepped through the rows before first.
+// 3 channel rows write one byte past their end; if last_row isn't NULL, row
+// last-1 goes there (n*img_x+1 bytes) so it cannot overwrite a row of the next band
+static void stbi__jpeg_convert_rows(stbi__jpeg *z, stbi_uc *output, int n, int decode_n, int is_rgb,
+                                    stbi__resample *res_comp, stbi_uc **linebuf, unsigned int first, unsigned int last,
+                                    stbi_uc *last_row)
+{
+   int k;
+   unsigned int i,j;
+   stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+   for (j=0; j < last; ++j) {
+      stbi_uc *out = last_row && j == last-1 ? last_row : output + n * z->s->img_x * j;
+      int convert = j >= first;
+      for (k=0; k < decode_n; ++k) {
+         stbi__resample *r = &res_comp[k];
+         int y_bot = r->ystep >= (r->vs >> 1);
+         if (convert)
+            coutput[k] = r->resample(linebuf[k],
+                                     y_bot ? r->line1 : r->line0,
+                                     y_bot ? r->line0 : r->line1,
+                                     r->w_lores, r->hs);
+         if (++r->ystep >= r->vs) {
+            r->ystep = 0;
+            r->line0 = r->line1;
+            if (++r->ypos < z->img_comp[k].y)
+               r->line1 += z->img_comp[k].w2;
+         }
+      }
+      if (!convert) continue;
+      if (n >= 3) {
+         stbi_uc *y = coutput[0];
+         if (z->s->img_n == 3) {
+            if (is_rgb) {
+               for (i=0; i < z->s->img_x; ++i) {
+                  out[0] = y[i];
+                  out[1] = coutput[1][i];
+                  out[2] = coutput[2][i];
+                  out[3] = 255;
+                  out += n;
+               }
+            } else {
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            }
+         } else if (z->s->img_n == 4) {
+            if (z->app14_color_transform == 0) { // CMYK
+               for (i=0; i < z->s->img_x; ++i) {
+                  stbi_uc m = coutput[3][i];
+                  out[0] = stbi__blinn_8x8(coutput[0][i], m);
+                  out[1] = stbi__blinn_8x8(coutput[1][i], m);
+                  out[2] = stbi__blinn_8x8(coutput[2][i], m);
+                  out[3] = 255;
+                  out += n;
+               }
+            } else if (z->app14_color_transform == 2) { // YCCK
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+               for (i=0; i < z->s->img_x; ++i) {
+                  stbi_uc m = coutput[3][i];
+                  out[0] = stbi__blinn_8x8(255 - out[0], m);
+                  out[1] = stbi__blinn_8x8(255 - out[1], m);
+                  out[2] = stbi__blinn_8x8(255 - out[2], m);
+                  out += n;
+               }
+            } else { // YCbCr + alpha?  Ignore the fourth channel for now
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            }
+         } else
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = out[1] = out[2] = y[i];
+               out[3] = 255; // not used if n==3
+               out += n;
+            }
+      } else {
+         if (is_rgb) {
+            if (n == 1)
+               for (i=0; i < z->s->img_x; ++i)
+                  *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+            else {
+               for (i=0; i < z->s->img_x; ++i, out += 2) {
+                  out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                  out[1] = 255;
+               }
+            }
+         } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
+            for (i=0; i < z->s->img_x; ++i) {
+               stbi_uc m = coutput[3][i];
+               stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
+               stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
+               stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
+               out[0] = stbi__compute_y(r, g, b);
+               out[1] = 255;
+               out += n;
+            }
+         } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
+               out[1] = 255;
+               out += n;
+            }
+         } else {
+            stbi_uc *y = coutput[0];
+            if (n == 1)
+               for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
+            else
+               for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
+         }
+      }
+   }
+}
+
+// rows per task of parallel color conversion
+#define STBI__JPEG_BAND_ROWS 32
+
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi_uc *output;
+   int n, decode_n, is_rgb;
+   stbi__resample res_comp[4];
+   stbi_uc *scratch; // per band: img_x+3 bytes per component, then a spare output row
+   size_t band_bytes;
+} stbi__jpeg_bands;
+
+static void stbi__jpeg_convert_band(void *task_user, int index)
+{
+   stbi__jpeg_bands *job = (stbi__jpeg_bands *) task_user;
+   stbi__jpeg *z = job->z;
+   stbi__resample res_comp[4];
+   stbi_uc *linebuf[4];
+   stbi_uc *scratch = job->scratch + job->band_bytes * index, *last_row;
+   unsigned int first = index * STBI__JPEG_BAND_ROWS, last = first + STBI__JPEG_BAND_ROWS;
+   int k;
+   if (last > z->s->img_y) last = z->s->img_y;
+   memcpy(res_comp, job->res_comp, sizeof(res_comp));
+   for (k=0; k < job->decode_n; ++k)
+      linebuf[k] = scratch + (size_t) k * (z->s->img_x + 3);
+   last_row = scratch + (size_t) job->decode_n * (z->s->img_x + 3);
+   stbi__jpeg_convert_rows(z, job->output, job->n, job->decode_n, job->is_rgb, res_comp, linebuf, first, last, last_row);
+   memcpy(job->output + (size_t) job->n * z->s->img_x * (last-1), last_row, (size_t) job->n * z->s->img_x);
+}
+
 static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
 {
    int n, decode_n, is_rgb;
@@ -3887,10 +4393,9 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
 
    // resample and color-convert
    {
-      int k;
-      unsigned int i,j;
-      stbi_uc *output;
-      stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+      int k, bands;
+      size_t band_bytes;
+      stbi_uc *output, *scratch = NULL;
 
       stbi__resample res_comp[4];
 
@@ -3920,100 +4425,29 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
       output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
       if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
-      // now go ahead and resample
-      for (j=0; j < z->s->img_y; ++j) {
-         stbi_uc *out = output + n * z->s->img_x * j;
-         for (k=0; k < decode_n; ++k) {
-            stbi__resample *r = &res_comp[k];
-            int y_bot = r->ystep >= (r->vs >> 1);
-            coutput[k] = r->resample(z->img_comp[k].linebuf,
-                                     y_bot ? r->line1 : r->line0,
-                                     y_bot ? r->line0 : r->line1,
-                                     r->w_lores, r->hs);
-            if (++r->ystep >= r->vs) {
-               r->ystep = 0;
-               r->line0 = r->line1;
-               if (++r->ypos < z->img_comp[k].y)
-                  r->line1 += z->img_comp[k].w2;
-            }
-         }
-         if (n >= 3) {
-            stbi_uc *y = coutput[0];
-            if (z->s->img_n == 3) {
-               if (is_rgb) {
-                  for (i=0; i < z->s->img_x; ++i) {
-                     out[0] = y[i];
-                     out[1] = coutput[1][i];
-                     out[2] = coutput[2][i];
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else {
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else if (z->s->img_n == 4) {
-               if (z->app14_color_transform == 0) { // CMYK
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(coutput[0][i], m);
-                     out[1] = stbi__blinn_8x8(coutput[1][i], m);
-                     out[2] = stbi__blinn_8x8(coutput[2][i], m);
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else if (z->app14_color_transform == 2) { // YCCK
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(255 - out[0], m);
-                     out[1] = stbi__blinn_8x8(255 - out[1], m);
-                     out[2] = stbi__blinn_8x8(255 - out[2], m);
-                     out += n;
-                  }
-               } else { // YCbCr + alpha?  Ignore the fourth channel for now
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = out[1] = out[2] = y[i];
-                  out[3] = 255; // not used if n==3
-                  out += n;
-               }
-         } else {
-            if (is_rgb) {
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i)
-                     *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-               else {
-                  for (i=0; i < z->s->img_x; ++i, out += 2) {
-                     out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                     out[1] = 255;
-                  }
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  stbi_uc m = coutput[3][i];
-                  stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
-                  stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
-                  stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
-                  out[0] = stbi__compute_y(r, g, b);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else {
-               stbi_uc *y = coutput[0];
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
-               else
-                  for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
-            }
-         }
+      // now go ahead and resample, in bands of rows if they can be done in parallel
+      // (each band with its own buffers; without memory for them, serially)
+      bands = (z->s->img_y + STBI__JPEG_BAND_ROWS - 1) / STBI__JPEG_BAND_ROWS;
+      band_bytes = (size_t) decode_n * (z->s->img_x + 3) + (size_t) n * z->s->img_x + 1;
+      if (stbi__parallel_for && !z->s->read_from_callbacks && bands >= 2 && band_bytes <= INT_MAX)
+         scratch = (stbi_uc *) stbi__malloc_mad2(bands, (int) band_bytes, 0);
+      if (scratch) {
+         stbi__jpeg_bands job;
+         job.z = z;
+         job.output = output;
+         job.n = n;
+         job.decode_n = decode_n;
+         job.is_rgb = is_rgb;
+         memcpy(job.res_comp, res_comp, sizeof(res_comp));
+         job.scratch = scratch;
+         job.band_bytes = band_bytes;
+         stbi__parallel_for(stbi__jpeg_convert_band, &job, bands, stbi__parallel_for_user);
+         STBI_FREE(scratch);
+      } else {
+         stbi_uc *linebuf[4];
+         for (k=0; k < decode_n; ++k)
+            linebuf[k] = z->img_comp[k].linebuf;
+         stbi__jpeg_convert_rows(z, output, n, decode_n, is_rgb, res_comp, linebuf, 0, z->s->img_y, NULL);
       }
       stbi__cleanup_jpeg(z);
       *out_x = z->s->img_x;
@@ -4082,6 +4516,9 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 //      - all output is written to a single output buffer (can malloc/realloc)
 //    performance
 //      - fast huffman
+//      - pairs of short literals decoded with one lookup
+//      - while far from the end of input and output, a loop that refills
+//        the bit buffer a word at a time and copies matches 8/16 bytes at a time
 
 #ifndef STBI_NO_ZLIB
 
@@ -4089,6 +4526,11 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 #define STBI__ZFAST_BITS  9 // accelerate all cases in default tables
 #define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
 #define STBI__ZNSYMS 288 // number of symbols in literal/length alphabet
+#define STBI__ZPAIR_BITS  9  // two literals whose codes fit in this many bits
+#define STBI__ZPAIR_MASK  ((1 << STBI__ZPAIR_BITS) - 1)
+
+// set to decode with the simple loop only (to compare them)
+static int stbi__zfast_disabled = 0;
 
 // zlib-style huffman encoding
 // (jpegs packs from left, zlib from right, so can't share code)
@@ -4184,6 +4626,8 @@ typedef struct
    int   z_expandable;
 
    stbi__zhuffman z_length, z_distance;
+   // two literals in one code of z_length: first | second << 8 | bits << 16, 0 if not
+   stbi__uint32 z_pairs[1 << STBI__ZPAIR_BITS];
 } stbi__zbuf;
 
 stbi_inline static int stbi__zeof(stbi__zbuf *z)
@@ -4292,9 +4736,155 @@ static const int stbi__zdist_base[32] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129
 static const int stbi__zdist_extra[32] =
 { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
 
-static int stbi__parse_huffman_block(stbi__zbuf *a)
+// fills z_pairs from the fast table of z_length: a literal whose code
+// leaves room for another one in STBI__ZPAIR_BITS. the second lookup only has
+// the bits left over, which is enough since fast[] repeats every short code
+static void stbi__zbuild_pairs(stbi__zbuf *a)
+{
+   int j;
+   for (j=0; j < (1 << STBI__ZPAIR_BITS); ++j) {
+      int b1 = a->z_length.fast[j & STBI__ZFAST_MASK], b2, s1;
+      a->z_pairs[j] = 0;
+      if (b1 == 0 || (b1 & 511) >= 256) continue;
+      s1 = b1 >> 9;
+      b2 = a->z_length.fast[(j >> s1) & STBI__ZFAST_MASK];
+      if (b2 == 0 || (b2 & 511) >= 256 || s1 + (b2 >> 9) > STBI__ZPAIR_BITS) continue;
+      a->z_pairs[j] = (stbi__uint32) ((b1 & 255) | ((b2 & 255) << 8) | ((s1 + (b2 >> 9)) << 16));
+   }
+}
+
+// input and output the fast loop needs left at the top of each symbol: three
+// refills of up to 3 bytes that read 4, and the longest match plus the
+// overshoot of a 16 byte copy
+#define STBI__ZFAST_INPUT   16
+#define STBI__ZFAST_OUTPUT  (258 + 16)
+
+// load 4 bytes into the bit buffer and keep the ones that fit. bits past
+// num_bits are the next bytes of input, so loading them again later ORs in
+// the same values
+#define STBI__ZREFILL() \
+   do { \
+      bits |= (stbi__uint32) (in[0] | (in[1] << 8) | (in[2] << 16) | ((stbi__uint32) in[3] << 24)) << num_bits; \
+      in += (31 - num_bits) >> 3; \
+      num_bits |= 24; \
+   } while (0)
+
+// the body of stbi__parse_huffman_block for as long as there is plenty of
+// input and output left, without checking for either. returns 1 at the end
+// of the block, 2 when it has to hand over to the careful loop, 0 on error
+static int stbi__parse_huffman_block_fast(stbi__zbuf *a)
 {
    char *zout = a->zout;
+   stbi_uc *in = a->zbuffer;
+   stbi__uint32 bits = a->code_buffer;
+   int num_bits = a->num_bits, result = 2;
+
+   while (a->zout_end - zout >= STBI__ZFAST_OUTPUT && a->zbuffer_end - in >= STBI__ZFAST_INPUT) {
+      stbi_uc *p;
+      int z,b,len,dist;
+      stbi__uint32 pair;
+      STBI__ZREFILL();
+      pair = a->z_pairs[bits & STBI__ZPAIR_MASK];
+      if (pair) {
+         zout[0] = (char) (pair & 255);
+         zout[1] = (char) ((pair >> 8) & 255);
+         zout += 2;
+         bits >>= pair >> 16;
+         num_bits -= pair >> 16;
+         continue;
+      }
+      b = a->z_length.fast[bits & STBI__ZFAST_MASK];
+      if (b) {
+         bits >>= b >> 9;
+         num_bits -= b >> 9;
+         z = b & 511;
+      } else {
+         a->code_buffer = bits; a->num_bits = num_bits;
+         z = stbi__zhuffman_decode_slowpath(a, &a->z_length);
+         bits = a->code_buffer; num_bits = a->num_bits;
+      }
+      if (z < 256) {
+         if (z < 0) { result = stbi__err("bad huffman code","Corrupt PNG"); break; } // error in huffman codes
+         *zout++ = (char) z;
+         continue;
+      }
+      if (z == 256) {
+         result = 1;
+         break;
+      }
+      if (z >= 286) { result = stbi__err("bad huffman code","Corrupt PNG"); break; } // per DEFLATE, length codes 286 and 287 must not appear in compressed data
+      z -= 257;
+      // at most 15 bits of code used since the refill, so the 5 extra bits are there
+      len = stbi__zlength_base[z];
+      if (stbi__zlength_extra[z]) {
+         len += bits & ((1 << stbi__zlength_extra[z]) - 1);
+         bits >>= stbi__zlength_extra[z];
+         num_bits -= stbi__zlength_extra[z];
+      }
+      STBI__ZREFILL();
+      b = a->z_distance.fast[bits & STBI__ZFAST_MASK];
+      if (b) {
+         bits >>= b >> 9;
+         num_bits -= b >> 9;
+         z = b & 511;
+      } else {
+         a->code_buffer = bits; a->num_bits = num_bits;
+         z = stbi__zhuffman_decode_slowpath(a, &a->z_distance);
+         bits = a->code_buffer; num_bits = a->num_bits;
+      }
+      if (z < 0 || z >= 30) { result = stbi__err("bad huffman code","Corrupt PNG"); break; } // per DEFLATE, distance codes 30 and 31 must not appear in compressed data
+      dist = stbi__zdist_base[z];
+      if (stbi__zdist_extra[z]) {
+         if (num_bits < stbi__zdist_extra[z]) STBI__ZREFILL();
+         dist += bits & ((1 << stbi__zdist_extra[z]) - 1);
+         bits >>= stbi__zdist_extra[z];
+         num_bits -= stbi__zdist_extra[z];
+      }
+      if (zout - a->zout_start < dist) { result = stbi__err("bad dist","Corrupt PNG"); break; }
+      p = (stbi_uc *) (zout - dist);
+      // copy whole words, past the end of the match if need be: the bytes
+      // after it are written again by what comes next. a word never reads
+      // bytes it writes as long as the distance is at least its size
+      if (dist >= 16) {
+         char *end = zout + len;
+         do { memcpy(zout, p, 16); zout += 16; p += 16; } while (zout < end);
+         zout = end;
+      } else if (dist >= 8) {
+         char *end = zout + len;
+         do { memcpy(zout, p, 8); zout += 8; p += 8; } while (zout < end);
+         zout = end;
+      } else if (dist == 1) { // run of one byte; common in images.
+         memset(zout, *p, len);
+         zout += len;
+      } else {
+         // a repeating pattern shorter than a word, like a run of pixels:
+         // it repeats every multiple of dist too, so once the first bytes
+         // are there, copy words from a whole number of patterns back
+         char *end = zout + len;
+         int step = dist * ((8 + dist - 1) / dist);
+         char *words = zout + (step - dist);
+         while (zout < end && zout < words) *zout++ = (char) *p++;
+         while (zout < end) { memcpy(zout, zout - step, 8); zout += 8; }
+         zout = end;
+      }
+   }
+
+   // back to what the careful loop expects: no bits past num_bits
+   a->zout = zout;
+   a->zbuffer = in;
+   a->code_buffer = bits & ((1U << num_bits) - 1);
+   a->num_bits = num_bits;
+   return result;
+}
+
+static int stbi__parse_huffman_block(stbi__zbuf *a)
+{
+   char *zout;
+   if (!stbi__zfast_disabled) {
+      int result = stbi__parse_huffman_block_fast(a);
+      if (result != 2) return result;
+   }
+   zout = a->zout;
    for(;;) {
       int z = stbi__zhuffman_decode(a, &a->z_length);
       if (z < 256) {
@@ -4479,6 +5069,7 @@ static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
          } else {
             if (!stbi__compute_huffman_codes(a)) return 0;
          }
+         if (!stbi__zfast_disabled) stbi__zbuild_pairs(a);
          if (!stbi__parse_huffman_block(a)) return 0;
       }
    } while (!final);
@@ -4646,6 +5237,89 @@ static int stbi__paeth(int a, int b, int c)
 
 static const stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
+#ifdef STBI_SSE2
+// set to unfilter with the scalar loops only (to compare them)
+static int stbi__png_simd_disabled = 0;
+
+static __m128i stbi__png_load4(const stbi_uc *p)
+{
+   int v;
+   memcpy(&v, p, 4);
+   return _mm_cvtsi32_si128(v);
+}
+
+static void stbi__png_store4(stbi_uc *p, __m128i v)
+{
+   int w = _mm_cvtsi128_si32(v);
+   memcpy(p, &w, 4);
+}
+
+// unfilters the row of 8-bit samples after its first pixel, like the scalar
+// loops in stbi__create_png_image_raw, and returns how many bytes it did.
+// "up" goes 16 bytes at a time; the others depend on the pixel to the left,
+// so they do a pixel at a time with all its channels together. 3 byte pixels
+// are loaded and stored as 4 bytes, so the last one is left to the scalar loop
+static int stbi__png_unfilter_sse2(int filter, stbi_uc *cur, stbi_uc *prior, stbi_uc *raw, int nk, int bpp)
+{
+   int k = 0;
+   __m128i zero = _mm_setzero_si128();
+   if (stbi__png_simd_disabled || !stbi__sse2_available()) return 0;
+
+   if (filter == STBI__F_up) {
+      for (; k+16 <= nk; k += 16) {
+         __m128i r = _mm_loadu_si128((__m128i *) (raw+k));
+         __m128i b = _mm_loadu_si128((__m128i *) (prior+k));
+         _mm_storeu_si128((__m128i *) (cur+k), _mm_add_epi8(r, b));
+      }
+      return k;
+   }
+   if (bpp != 3 && bpp != 4) return 0;
+
+   if (filter == STBI__F_sub) {
+      __m128i a = stbi__png_load4(cur-bpp);
+      for (; k+4 <= nk; k += bpp) {
+         a = _mm_add_epi8(stbi__png_load4(raw+k), a);
+         stbi__png_store4(cur+k, a);
+      }
+   } else if (filter == STBI__F_avg) {
+      // (a+b)>>1 is the rounded up average minus the rounding
+      __m128i one = _mm_set1_epi8(1);
+      __m128i a = stbi__png_load4(cur-bpp);
+      for (; k+4 <= nk; k += bpp) {
+         __m128i b = stbi__png_load4(prior+k);
+         __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+         a = _mm_add_epi8(stbi__png_load4(raw+k), avg);
+         stbi__png_store4(cur+k, a);
+      }
+   } else if (filter == STBI__F_paeth) {
+      // stbi__paeth on shorts: p-a = b-c, p-b = a-c, p-c = (b-c)+(a-c),
+      // and the predictor with the smallest distance wins, a then b on ties
+      __m128i a = _mm_unpacklo_epi8(stbi__png_load4(cur-bpp), zero);
+      __m128i c = _mm_unpacklo_epi8(stbi__png_load4(prior-bpp), zero);
+      for (; k+4 <= nk; k += bpp) {
+         __m128i b  = _mm_unpacklo_epi8(stbi__png_load4(prior+k), zero);
+         __m128i pa = _mm_sub_epi16(b, c);
+         __m128i pb = _mm_sub_epi16(a, c);
+         __m128i pc = _mm_add_epi16(pa, pb);
+         __m128i smallest, use_a, use_b, pred;
+         pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+         pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+         pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+         smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+         use_a = _mm_cmpeq_epi16(smallest, pa);
+         use_b = _mm_andnot_si128(use_a, _mm_cmpeq_epi16(smallest, pb));
+         pred = _mm_or_si128(_mm_or_si128(_mm_and_si128(use_a, a), _mm_and_si128(use_b, b)),
+                             _mm_andnot_si128(_mm_or_si128(use_a, use_b), c));
+         a = _mm_add_epi8(stbi__png_load4(raw+k), _mm_packus_epi16(pred, pred));
+         stbi__png_store4(cur+k, a);
+         a = _mm_unpacklo_epi8(a, zero);
+         c = b;
+      }
+   }
+   return k;
+}
+#endif
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4728,9 +5402,13 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
       // this is a little gross, so that we don't switch per-pixel or per-component
       if (depth < 8 || img_n == out_n) {
          int nk = (width - 1)*filter_bytes;
+         int done = 0; // bytes already unfiltered with SIMD
+         #ifdef STBI_SSE2
+         if (depth == 8) done = stbi__png_unfilter_sse2(filter, cur, prior, raw, nk, filter_bytes);
+         #endif
          #define STBI__CASE(f) \
              case f:     \
-                for (k=0; k < nk; ++k)
+                for (k=done; k < nk; ++k)
          switch (filter) {
             // "none" filter turns into a memcpy here; make that explicit.
             case STBI__F_none:         memcpy(cur, raw, nk); break;
@@ -0,0 +1,146 @@
+// Offline atlas builder: packs a set of images into as few pages as it can
+// (TextureAtlas: skyline packing, padded cells with edge-repeating gutters)
+// and writes each page as a 32-bit TGA plus a table of where every image went.
+//
+//	atlas_builder atlases/sprites 512 [--padding 2] ball.png paddle.png brick.png ...
+//
+// writes atlases/sprites0.tga, atlases/sprites1.tga... and atlases/sprites.atlas,
+// one line per image: name page x y width height u0 v0 u1 v1 (name is the file
+// stem, v grows downwards like the TGA rows). Build it with ../TextureAtlas.cpp.
+// Images are packed tallest first, which is what skyline packing does best with.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
+#include "../TextureAtlas.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	struct Image
+	{
+		std::string name;
+		int width;
+		int height;
+		std::vector<unsigned char> rgba;
+	};
+
+	// uncompressed true color, alpha included, rows top to bottom
+	bool writeTga(const std::string& path, const TextureAtlas& page)
+	{
+		unsigned char header[18] = {};
+		header[2] = 2;
+		header[12] = page.width & 0xFF;
+		header[13] = page.width >> 8;
+		header[14] = page.height & 0xFF;
+		header[15] = page.height >> 8;
+		header[16] = 32;
+		header[17] = 0x28;	// 8 alpha bits, top-left origin
+		std::vector<unsigned char> bgra(page.pixels);
+		for (size_t i = 0; i < bgra.size(); i += 4)
+			std::swap(bgra[i], bgra[i + 2]);
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(bgra.data()), bgra.size());
+		return (bool)file;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::cout << "usage: atlas_builder <output> <page size> [--padding n] <image>..." << std::endl;
+		return 1;
+	}
+	std::string output = argv[1];
+	int pageSize = std::atoi(argv[2]);
+	int padding = 2;
+	std::vector<Image> images;
+	for (int i = 3; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--padding" && i + 1 < argc)
+		{
+			padding = std::atoi(argv[++i]);
+			continue;
+		}
+		int width, height, channels;
+		unsigned char* pixels = stbi_load(arg.c_str(), &width, &height, &channels, 4);
+		if (!pixels)
+		{
+			std::cout << "ERROR::ATLAS " << arg << ": " << stbi_failure_reason() << std::endl;
+			return 1;
+		}
+		// entries are named by the file name alone; the atlas keeps one image per name
+		std::string name = fs::path(arg).stem().string();
+		for (const Image& image : images)
+		{
+			if (image.name == name)
+			{
+				std::cout << "ERROR::ATLAS two images named " << name << std::endl;
+				stbi_image_free(pixels);
+				return 1;
+			}
+		}
+		images.push_back({ name, width, height,
+			std::vector<unsigned char>(pixels, pixels + (size_t)width * height * 4) });
+		stbi_image_free(pixels);
+	}
+	if (pageSize <= 0)
+	{
+		std::cout << "ERROR::ATLAS bad page size " << argv[2] << std::endl;
+		return 1;
+	}
+	std::stable_sort(images.begin(), images.end(), [](const Image& a, const Image& b) {
+		return a.height != b.height ? a.height > b.height : a.width > b.width;
+	});
+
+	// a new page whenever an image does not fit in the ones so far
+	std::vector<std::unique_ptr<TextureAtlas>> pages;
+	std::ofstream table(output + ".atlas");
+	table << "# name page x y width height u0 v0 u1 v1" << std::endl;
+	for (const Image& image : images)
+	{
+		int index = -1;
+		size_t page = 0;
+		for (; page < pages.size() && index < 0; page++)
+			index = pages[page]->add(image.name, image.width, image.height, image.rgba.data());
+		if (index < 0)
+		{
+			pages.push_back(std::make_unique<TextureAtlas>(pageSize, pageSize, 4, padding));
+			index = pages.back()->add(image.name, image.width, image.height, image.rgba.data());
+			page = pages.size();
+			if (index < 0)
+			{
+				std::cout << "ERROR::ATLAS " << image.name << " (" << image.width << "x" << image.height <<
+					") does not fit in a " << pageSize << " page" << std::endl;
+				return 1;
+			}
+		}
+		const AtlasEntry& entry = pages[page - 1]->entry(index);
+		table << image.name << " " << page - 1 << " " << entry.x << " " << entry.y << " " << entry.width << " " <<
+			entry.height << " " << entry.u0 << " " << entry.v0 << " " << entry.u1 << " " << entry.v1 << std::endl;
+	}
+
+	for (size_t i = 0; i < pages.size(); i++)
+	{
+		std::string path = output + std::to_string(i) + ".tga";
+		if (!writeTga(path, *pages[i]))
+		{
+			std::cout << "ERROR::ATLAS " << path << ": cannot write" << std::endl;
+			return 1;
+		}
+		std::cout << path << ": " << pages[i]->size() << " images, " << (int)(pages[i]->occupancy() * 100.0f) <<
+			"% used" << std::endl;
+	}
+	return 0;
+}
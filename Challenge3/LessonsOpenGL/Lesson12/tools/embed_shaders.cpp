@@ -0,0 +1,129 @@
+// Build step: embeds every shader under a directory into a C++ header as
+// constexpr std::string_view tables, so shipped builds do not read res/ at runtime.
+//
+//	embed_shaders res EmbeddedShaders.h
+//
+// Run it from the lesson directory (Visual Studio: as a pre-build event). The
+// header is only rewritten when its content changes, so it does not trigger
+// needless rebuilds. Sources are embedded byte for byte (line endings included).
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	bool isShader(const fs::path& path)
+	{
+		std::string extension = path.extension().string();
+		return extension == ".vs" || extension == ".fs" || extension == ".glsl";
+	}
+
+	// one string literal per source line, escaped so the bytes come out unchanged
+	std::string literal(const std::string& text)
+	{
+		std::string out = "\t\t\"";
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			unsigned char c = (unsigned char)text[i];
+			switch (c)
+			{
+			case '\\': out += "\\\\"; break;
+			case '"': out += "\\\""; break;
+			case '\t': out += "\\t"; break;
+			case '\r': out += "\\r"; break;
+			case '\n':
+				out += "\\n\"";
+				if (i + 1 < text.size())
+					out += "\n\t\t\"";
+				else
+					return out;
+				break;
+			default:
+				if (c < 32 || c >= 127)
+				{
+					// octal escapes cannot swallow the following characters like hex ones
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\%03o", c);
+					out += escaped;
+				}
+				else
+				{
+					out += (char)c;
+				}
+			}
+		}
+		return out + "\"";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		std::cout << "usage: embed_shaders <shader directory> <output header>" << std::endl;
+		return 1;
+	}
+	fs::path directory = argv[1];
+	fs::path output = argv[2];
+
+	std::vector<fs::path> shaders;
+	std::error_code ec;
+	for (fs::recursive_directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+		if (it->is_regular_file() && isShader(it->path()))
+			shaders.push_back(it->path());
+	if (ec)
+	{
+		std::cout << "ERROR::EMBED_SHADERS " << directory.string() << ": " << ec.message() << std::endl;
+		return 1;
+	}
+	// stable order, so the header only changes when a shader does
+	std::sort(shaders.begin(), shaders.end());
+
+	std::ostringstream header;
+	header << "// Generated by tools/embed_shaders.cpp from " << directory.generic_string() << "/ - do not edit.\n"
+		<< "#pragma once\n\n"
+		<< "#ifndef EMBEDDEDSHADERS_H\n#define EMBEDDEDSHADERS_H\n\n"
+		<< "#include <string_view>\n\n"
+		<< "struct EmbeddedShader\n{\n\tstd::string_view path;\n\tstd::string_view source;\n};\n\n"
+		<< "inline constexpr EmbeddedShader embeddedShaders[] = {\n";
+	for (const fs::path& shader : shaders)
+	{
+		std::ifstream file(shader, std::ios::binary);
+		std::stringstream content;
+		content << file.rdbuf();
+		if (!file)
+		{
+			std::cout << "ERROR::EMBED_SHADERS " << shader.string() << ": cannot read" << std::endl;
+			return 1;
+		}
+		std::string text = content.str();
+		header << "\t{ \"" << shader.generic_string() << "\",\n"
+			<< (text.empty() ? "\t\t\"\"" : literal(text)) << " },\n";
+	}
+	header << "};\n\n#endif\n";
+
+	std::string generated = header.str();
+	// the header itself is text: native line endings
+	std::ifstream current(output);
+	std::stringstream existing;
+	existing << current.rdbuf();
+	if (current && existing.str() == generated)
+		return 0;
+
+	std::ofstream out(output);
+	if (!(out << generated))
+	{
+		std::cout << "ERROR::EMBED_SHADERS " << output.string() << ": cannot write" << std::endl;
+		return 1;
+	}
+	std::cout << "embedded " << shaders.size() << " shaders into " << output.string() << std::endl;
+	return 0;
+}
@@ -0,0 +1,422 @@
+// Offline optimization pass: finds products of mat4 uniforms in the shaders,
+// such as projection * view * model, which every vertex recomputes although
+// they are the same for the whole draw. Each shader with such products gets an
+// optimized copy taking the product as one more uniform, and a C++ header
+// lists the products so Shader can compute them on the CPU.
+//
+//	hoist_uniforms res HoistedUniforms.h
+//
+// Run it from the lesson directory, before embed_shaders. res/cube.vs becomes
+// res/cube.opt.vs (next to it, so its includes still resolve); files are only
+// rewritten when their content changes.
+//
+// Only the leading operands of a * chain are hoisted, since * is left
+// associative: in projection * view * model * vec4(aPos, 1.0) the product is
+// (projection * view * model), but not in vec4(aPos, 1.0) * ... or a / b * c.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// Shader::HoistedUniform holds at most this many operands
+	const size_t MAX_OPERANDS = 4;
+
+	struct Token
+	{
+		std::string text;
+		size_t begin;
+		size_t end;
+	};
+
+	struct Uniform
+	{
+		std::string type;
+		// members of an anonymous-instance block are named "Block.member" in the header
+		std::string block;
+	};
+
+	// a product found in a source, replaced by a single uniform
+	struct Product
+	{
+		size_t begin;
+		size_t end;
+		std::vector<std::string> operands;
+	};
+
+	bool isShader(const fs::path& path)
+	{
+		std::string extension = path.extension().string();
+		return (extension == ".vs" || extension == ".fs") && path.stem().extension() != ".opt";
+	}
+
+	bool readFile(const fs::path& path, std::string& text)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::stringstream content;
+		content << file.rdbuf();
+		text = content.str();
+		return (bool)file;
+	}
+
+	// writes only when the content changes, so builds are not triggered for nothing
+	bool writeFile(const fs::path& path, const std::string& text)
+	{
+		std::string existing;
+		if (readFile(path, existing) && existing == text)
+			return true;
+		std::ofstream file(path, std::ios::binary);
+		if (!(file << text))
+		{
+			std::cout << "ERROR::HOIST_UNIFORMS " << path.string() << ": cannot write" << std::endl;
+			return false;
+		}
+		std::cout << "wrote " << path.generic_string() << std::endl;
+		return true;
+	}
+
+	bool isIdentifierStart(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+	}
+
+	bool isIdentifierChar(char c)
+	{
+		return isIdentifierStart(c) || (c >= '0' && c <= '9');
+	}
+
+	// GLSL tokens without comments and preprocessor lines
+	std::vector<Token> tokenize(const std::string& source)
+	{
+		static const char* const operators[] = {
+			"++", "--", "+=", "-=", "*=", "/=", "==", "!=", "<=", ">=", "&&", "||", "<<", ">>"
+		};
+		std::vector<Token> tokens;
+		bool lineStart = true;
+		size_t i = 0;
+		while (i < source.size())
+		{
+			char c = source[i];
+			if (c == '\n')
+			{
+				lineStart = true;
+				i++;
+			}
+			else if (c == ' ' || c == '\t' || c == '\r')
+				i++;
+			else if (source.compare(i, 2, "//") == 0)
+				i = std::min(source.find('\n', i), source.size());
+			else if (source.compare(i, 2, "/*") == 0)
+			{
+				size_t close = source.find("*/", i + 2);
+				i = close == std::string::npos ? source.size() : close + 2;
+			}
+			else if (c == '#' && lineStart)
+			{
+				// directives run to the end of the line, continuations included
+				while (i < source.size() && !(source[i] == '\n' && source[i - 1] != '\\'))
+					i++;
+			}
+			else
+			{
+				lineStart = false;
+				Token token;
+				token.begin = i;
+				if (isIdentifierStart(c))
+				{
+					while (i < source.size() && isIdentifierChar(source[i]))
+						i++;
+				}
+				else if ((c >= '0' && c <= '9') || (c == '.' && i + 1 < source.size() && source[i + 1] >= '0' && source[i + 1] <= '9'))
+				{
+					while (i < source.size() && (isIdentifierChar(source[i]) || source[i] == '.' ||
+						((source[i] == '+' || source[i] == '-') && (source[i - 1] == 'e' || source[i - 1] == 'E'))))
+						i++;
+				}
+				else
+				{
+					i++;
+					for (const char* op : operators)
+					{
+						if (source.compare(token.begin, 2, op) == 0)
+						{
+							i = token.begin + 2;
+							break;
+						}
+					}
+				}
+				token.end = i;
+				token.text = source.substr(token.begin, token.end - token.begin);
+				tokens.push_back(token);
+			}
+		}
+		return tokens;
+	}
+
+	// #include "name" directives of a source, in order
+	std::vector<std::string> includes(const std::string& source)
+	{
+		std::vector<std::string> names;
+		std::istringstream lines(source);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			size_t hash = line.find_first_not_of(" \t");
+			if (hash == std::string::npos || line[hash] != '#')
+				continue;
+			size_t word = line.find_first_not_of(" \t", hash + 1);
+			if (word == std::string::npos || line.compare(word, 7, "include") != 0)
+				continue;
+			size_t open = line.find('"', word + 7);
+			size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if (close != std::string::npos)
+				names.push_back(line.substr(open + 1, close - open - 1));
+		}
+		return names;
+	}
+
+	bool isPrecision(const std::string& word)
+	{
+		return word == "lowp" || word == "mediump" || word == "highp";
+	}
+
+	// uniform declarations, plain and inside blocks
+	void collectUniforms(const std::vector<Token>& tokens, std::map<std::string, Uniform>& uniforms)
+	{
+		for (size_t i = 0; i < tokens.size(); i++)
+		{
+			if (tokens[i].text != "uniform")
+				continue;
+			size_t j = i + 1;
+			while (j < tokens.size() && isPrecision(tokens[j].text))
+				j++;
+			if (j + 1 >= tokens.size())
+				break;
+
+			if (tokens[j + 1].text == "{")
+			{
+				// block: every "type name;" up to the closing brace
+				std::string block = tokens[j].text;
+				std::vector<std::pair<std::string, std::string>> members;
+				size_t k = j + 2, statement = k;
+				for (; k < tokens.size() && tokens[k].text != "}"; k++)
+				{
+					if (tokens[k].text == ";")
+					{
+						// the name is the last identifier before any array size, the type the one before it
+						size_t name = statement;
+						while (name < k && tokens[name].text != "[")
+							name++;
+						if (name >= statement + 2)
+							members.push_back({ tokens[name - 2].text, tokens[name - 1].text });
+						statement = k + 1;
+					}
+				}
+				// members of a block with an instance name are reached as instance.member: not handled
+				bool anonymous = k + 1 < tokens.size() && tokens[k + 1].text == ";";
+				if (anonymous)
+				{
+					for (const auto& member : members)
+						uniforms[member.second] = { member.first, block };
+				}
+				i = k;
+			}
+			else
+			{
+				// "uniform type a, b[2], c;"
+				std::string type = tokens[j].text;
+				for (size_t k = j + 1; k < tokens.size() && tokens[k].text != ";"; k++)
+				{
+					if (isIdentifierStart(tokens[k].text[0]) && (tokens[k - 1].text == type || tokens[k - 1].text == ","))
+						uniforms[tokens[k].text] = { type, "" };
+				}
+			}
+		}
+	}
+
+	// leading mat4 uniform products of every expression
+	std::vector<Product> findProducts(const std::vector<Token>& tokens, const std::map<std::string, Uniform>& uniforms)
+	{
+		// tokens after which an operand starts an expression, or the left side of a sum
+		static const std::set<std::string> starts = {
+			"=", "(", ",", "return", "+", "-", "?", ":", "+=", "-=", "*=", "{", ";"
+		};
+		auto isMatrix = [&](size_t i)
+		{
+			auto uniform = uniforms.find(tokens[i].text);
+			if (uniform == uniforms.end() || uniform->second.type != "mat4")
+				return false;
+			// indexed or swizzled values are not the whole matrix
+			return i + 1 >= tokens.size() || (tokens[i + 1].text != "[" && tokens[i + 1].text != "." && tokens[i + 1].text != "(");
+		};
+
+		std::vector<Product> products;
+		for (size_t i = 1; i < tokens.size(); i++)
+		{
+			if (!starts.count(tokens[i - 1].text) || !isMatrix(i))
+				continue;
+			Product product;
+			product.begin = tokens[i].begin;
+			product.operands.push_back(tokens[i].text);
+			size_t last = i;
+			while (last + 2 < tokens.size() && product.operands.size() < MAX_OPERANDS &&
+				tokens[last + 1].text == "*" && isMatrix(last + 2))
+			{
+				last += 2;
+				product.operands.push_back(tokens[last].text);
+			}
+			if (product.operands.size() < 2)
+				continue;
+			product.end = tokens[last].end;
+			products.push_back(product);
+			i = last;
+		}
+		return products;
+	}
+
+	std::string productName(const Product& product)
+	{
+		std::string name;
+		for (const std::string& operand : product.operands)
+			name += (name.empty() ? "" : "_") + operand;
+		return name;
+	}
+
+	// reads a shader and its includes (each once), collecting their uniforms
+	bool loadUniforms(const fs::path& path, std::set<fs::path>& visited, std::map<std::string, Uniform>& uniforms)
+	{
+		if (!visited.insert(path.lexically_normal()).second)
+			return true;
+		std::string source;
+		if (!readFile(path, source))
+		{
+			std::cout << "ERROR::HOIST_UNIFORMS " << path.string() << ": cannot read" << std::endl;
+			return false;
+		}
+		bool ok = true;
+		for (const std::string& name : includes(source))
+			ok = loadUniforms(path.parent_path() / name, visited, uniforms) && ok;
+		collectUniforms(tokenize(source), uniforms);
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		std::cout << "usage: hoist_uniforms <shader directory> <output header>" << std::endl;
+		return 1;
+	}
+	fs::path directory = argv[1];
+	fs::path output = argv[2];
+
+	std::vector<fs::path> shaders;
+	std::error_code ec;
+	for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+		if (it->is_regular_file() && isShader(it->path()))
+			shaders.push_back(it->path());
+	if (ec)
+	{
+		std::cout << "ERROR::HOIST_UNIFORMS " << directory.string() << ": " << ec.message() << std::endl;
+		return 1;
+	}
+	std::sort(shaders.begin(), shaders.end());
+
+	std::ostringstream table;
+	int count = 0;
+	for (const fs::path& shader : shaders)
+	{
+		std::map<std::string, Uniform> uniforms;
+		std::set<fs::path> visited;
+		std::string source;
+		if (!loadUniforms(shader, visited, uniforms) || !readFile(shader, source))
+			return 1;
+		std::vector<Product> products = findProducts(tokenize(source), uniforms);
+		fs::path optimized = shader.parent_path() / (shader.stem().string() + ".opt" + shader.extension().string());
+		if (products.empty())
+		{
+			// nothing to hoist anymore: drop a stale optimized copy
+			fs::remove(optimized, ec);
+			continue;
+		}
+
+		// replace from the end, so the offsets of the earlier products stay valid
+		std::string rewritten = source;
+		std::vector<std::string> declared;
+		for (auto product = products.rbegin(); product != products.rend(); ++product)
+		{
+			std::string name = productName(*product);
+			rewritten.replace(product->begin, product->end - product->begin, name);
+			if (std::find(declared.begin(), declared.end(), name) != declared.end())
+				continue;
+			declared.push_back(name);
+
+			table << "\t{ \"" << optimized.generic_string() << "\", \"" << name << "\", { ";
+			for (size_t i = 0; i < product->operands.size(); i++)
+			{
+				const Uniform& uniform = uniforms[product->operands[i]];
+				table << (i ? ", " : "") << "\"" << (uniform.block.empty() ? "" : uniform.block + ".") << product->operands[i] << "\"";
+			}
+			table << " }, " << product->operands.size() << " },\n";
+			count++;
+		}
+
+		// the new uniforms go right after #version, which has to stay first
+		std::string newline = source.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+		std::string declarations = "// generated by tools/hoist_uniforms from " + shader.filename().string() +
+			": products computed once per draw on the CPU" + newline;
+		for (auto name = declared.rbegin(); name != declared.rend(); ++name)
+			declarations += "uniform mat4 " + *name + ";" + newline;
+		size_t version = rewritten.find("#version");
+		size_t insertAt = version == std::string::npos ? 0 : rewritten.find('\n', version);
+		if (insertAt == std::string::npos)
+		{
+			rewritten += newline;
+			insertAt = rewritten.size();
+		}
+		else if (version != std::string::npos)
+			insertAt++;
+		rewritten.insert(insertAt, declarations);
+		if (!writeFile(optimized, rewritten))
+			return 1;
+	}
+
+	std::ostringstream header;
+	header << "// Generated by tools/hoist_uniforms.cpp from " << directory.generic_string() << "/ - do not edit.\n"
+		<< "#pragma once\n\n"
+		<< "#ifndef HOISTEDUNIFORMS_H\n#define HOISTEDUNIFORMS_H\n\n"
+		<< "#include <string_view>\n\n"
+		<< "// a mat4 uniform of an optimized shader standing for the product of other\n"
+		<< "// uniforms; operands in a block are \"Block.member\"\n"
+		<< "struct HoistedUniform\n{\n\tstd::string_view shader;\n\tstd::string_view name;\n"
+		<< "\tstd::string_view operands[" << MAX_OPERANDS << "];\n\tint operandCount;\n};\n\n"
+		<< "inline constexpr int hoistedUniformCount = " << count << ";\n"
+		<< "inline constexpr HoistedUniform hoistedUniforms[] = {\n"
+		<< (count ? table.str() : "\t{ \"\", \"\", {}, 0 },\n")
+		<< "};\n\n#endif\n";
+	// the header itself is text: native line endings
+	std::string generated = header.str();
+	std::ifstream current(output);
+	std::stringstream existing;
+	existing << current.rdbuf();
+	if (current && existing.str() == generated)
+		return 0;
+	std::ofstream out(output);
+	if (!(out << generated))
+	{
+		std::cout << "ERROR::HOIST_UNIFORMS " << output.string() << ": cannot write" << std::endl;
+		return 1;
+	}
+	std::cout << "hoisted " << count << " uniform products into " << output.string() << std::endl;
+	return 0;
+}
@@ -0,0 +1,95 @@
+// Benchmark and parity check of parallel JPEG decoding: decodes an image with
+// the serial stb_image decoder, then with a DecodePool of 1 to N threads,
+// and checks every parallel decode gives exactly the same pixels.
+//
+//	jpeg_bench textures/wall.jpg [max threads] [runs]
+//
+// Build it with ../DecodePool.cpp. Times are the median of the runs. Only
+// baseline JPEGs with restart intervals decode their entropy data in
+// parallel; every JPEG gets parallel color conversion.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
+#include "../DecodePool.h"
+
+namespace
+{
+	struct Result
+	{
+		double milliseconds;
+		std::vector<unsigned char> pixels;
+	};
+
+	bool decode(const std::vector<unsigned char>& file, int runs, Result& result)
+	{
+		std::vector<double> times;
+		for (int run = 0; run < runs; run++)
+		{
+			int width, height, channels;
+			auto start = std::chrono::steady_clock::now();
+			unsigned char* pixels = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 0);
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			if (!pixels)
+			{
+				std::cout << "ERROR::JPEG_BENCH " << stbi_failure_reason() << std::endl;
+				return false;
+			}
+			if (run == 0)
+				result.pixels.assign(pixels, pixels + (size_t)width * height * channels);
+			stbi_image_free(pixels);
+		}
+		std::sort(times.begin(), times.end());
+		result.milliseconds = times[times.size() / 2];
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: jpeg_bench <image.jpg> [max threads] [runs]" << std::endl;
+		return 1;
+	}
+	int maxThreads = argc > 2 ? std::atoi(argv[2]) : (int)std::max(1u, std::thread::hardware_concurrency());
+	int runs = argc > 3 ? std::max(1, std::atoi(argv[3])) : 20;
+	std::ifstream in(argv[1], std::ios::binary);
+	std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if (file.empty())
+	{
+		std::cout << "ERROR::JPEG_BENCH cannot read " << argv[1] << std::endl;
+		return 1;
+	}
+
+	Result serial;
+	if (!decode(file, runs, serial))
+		return 1;
+	std::cout << "serial: " << serial.milliseconds << " ms" << std::endl;
+
+	bool identical = true;
+	for (int threads = 1; threads <= maxThreads; threads++)
+	{
+		// the calling thread works too
+		DecodePool pool(threads - 1);
+		pool.install();
+		Result parallel;
+		if (!decode(file, runs, parallel))
+			return 1;
+		bool same = parallel.pixels == serial.pixels;
+		identical = identical && same;
+		std::cout << threads << " threads: " << parallel.milliseconds << " ms, x" <<
+			serial.milliseconds / parallel.milliseconds << (same ? "" : " MISMATCH") << std::endl;
+	}
+	std::cout << (identical ? "output identical to the serial decoder" : "ERROR::JPEG_BENCH output differs") << std::endl;
+	return identical ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+// Parity check and benchmark of the AVX2 JPEG kernels in stb_image: runs the
+// AVX2 upsampler and color converter against the scalar and SSE2 ones on
+// random rows of every width up to 300 (checking they don't write past the
+// row either), then decodes an image with and without AVX2.
+//
+//	jpeg_kernels textures/wall.jpg [runs]
+//
+// Times are the median of the runs; the kernels run on rows of 1024 pixels.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
+
+#ifndef STBI_AVX2
+#error "stb_image was built without its AVX2 kernels"
+#endif
+
+namespace
+{
+	typedef stbi_uc* (*Resample)(stbi_uc*, stbi_uc*, stbi_uc*, int, int);
+	typedef void (*ColorConvert)(stbi_uc*, const stbi_uc*, const stbi_uc*, const stbi_uc*, int, int);
+
+	// bytes past the row that must be left alone
+	const int guard = 64;
+
+	std::mt19937 randomBytes(1234);
+
+	std::vector<stbi_uc> randomRow(int size)
+	{
+		std::vector<stbi_uc> row(size);
+		for (stbi_uc& byte : row)
+			byte = (stbi_uc)randomBytes();
+		return row;
+	}
+
+	std::vector<stbi_uc> resample(Resample kernel, std::vector<stbi_uc>& near, std::vector<stbi_uc>& far, int width)
+	{
+		std::vector<stbi_uc> out(width * 2 + guard, 0xcd);
+		kernel(out.data(), near.data(), far.data(), width, 2);
+		return out;
+	}
+
+	std::vector<stbi_uc> convert(ColorConvert kernel, const std::vector<stbi_uc>& y, const std::vector<stbi_uc>& cb,
+		const std::vector<stbi_uc>& cr, int width, int step)
+	{
+		// one byte past a 3 channel row is written by every kernel
+		std::vector<stbi_uc> out(width * step + 1 + guard, 0xcd);
+		kernel(out.data(), y.data(), cb.data(), cr.data(), width, step);
+		return out;
+	}
+
+	bool checkKernels()
+	{
+		bool identical = true;
+		for (int width = 1; width <= 300; width++)
+		{
+			for (int trial = 0; trial < 20; trial++)
+			{
+				// the upsampler reads the pixel after each block of 16, up to the last one
+				std::vector<stbi_uc> near = randomRow(width), far = randomRow(width);
+				std::vector<stbi_uc> scalar = resample(stbi__resample_row_hv_2, near, far, width);
+				if (resample(stbi__resample_row_hv_2_simd, near, far, width) != scalar ||
+					resample(stbi__resample_row_hv_2_avx2, near, far, width) != scalar)
+				{
+					std::cout << "ERROR::JPEG_KERNELS upsampling differs at width " << width << std::endl;
+					identical = false;
+				}
+
+				std::vector<stbi_uc> y = randomRow(width), cb = randomRow(width), cr = randomRow(width);
+				for (int step = 3; step <= 4; step++)
+				{
+					std::vector<stbi_uc> reference = convert(stbi__YCbCr_to_RGB_row, y, cb, cr, width, step);
+					if (convert(stbi__YCbCr_to_RGB_simd, y, cb, cr, width, step) != reference ||
+						convert(stbi__YCbCr_to_RGB_avx2, y, cb, cr, width, step) != reference)
+					{
+						std::cout << "ERROR::JPEG_KERNELS color conversion differs at width " << width <<
+							", " << step << " channels" << std::endl;
+						identical = false;
+					}
+				}
+			}
+		}
+		return identical;
+	}
+
+	template <typename Run>
+	double median(int runs, Run run)
+	{
+		std::vector<double> times;
+		for (int i = 0; i < runs; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			run();
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+
+	// megapixels per second of each kernel over many rows
+	void benchmarkKernels(int runs)
+	{
+		const int width = 1024, rows = 1000;
+		std::vector<stbi_uc> near = randomRow(width + 1), far = randomRow(width + 1);
+		std::vector<stbi_uc> y = randomRow(width), cb = randomRow(width), cr = randomRow(width);
+		std::vector<stbi_uc> out(width * 4 + 1);
+		const double megapixels = (double)width * rows / 1e6;
+
+		const Resample resamplers[] = { stbi__resample_row_hv_2, stbi__resample_row_hv_2_simd, stbi__resample_row_hv_2_avx2 };
+		const ColorConvert converters[] = { stbi__YCbCr_to_RGB_row, stbi__YCbCr_to_RGB_simd, stbi__YCbCr_to_RGB_avx2 };
+		const char* names[] = { "scalar", "SSE2", "AVX2" };
+		for (int k = 0; k < 3; k++)
+		{
+			double upsample = median(runs, [&]() {
+				for (int row = 0; row < rows; row++)
+					resamplers[k](out.data(), near.data(), far.data(), width, 2);
+			});
+			double rgb = median(runs, [&]() {
+				for (int row = 0; row < rows; row++)
+					converters[k](out.data(), y.data(), cb.data(), cr.data(), width, 3);
+			});
+			double rgba = median(runs, [&]() {
+				for (int row = 0; row < rows; row++)
+					converters[k](out.data(), y.data(), cb.data(), cr.data(), width, 4);
+			});
+			std::cout << names[k] << ": upsampling " << megapixels / upsample * 1000.0 << " Mpx/s, RGB " <<
+				megapixels / rgb * 1000.0 << " Mpx/s, RGBA " << megapixels / rgba * 1000.0 << " Mpx/s" << std::endl;
+		}
+	}
+
+	bool decode(const std::vector<unsigned char>& file, int runs, double& milliseconds, std::vector<unsigned char>& pixels)
+	{
+		bool ok = true;
+		milliseconds = median(runs, [&]() {
+			int width, height, channels;
+			unsigned char* data = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 0);
+			if (!data)
+			{
+				ok = false;
+				return;
+			}
+			pixels.assign(data, data + (size_t)width * height * channels);
+			stbi_image_free(data);
+		});
+		if (!ok)
+			std::cout << "ERROR::JPEG_KERNELS " << stbi_failure_reason() << std::endl;
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: jpeg_kernels <image.jpg> [runs]" << std::endl;
+		return 1;
+	}
+	int runs = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20;
+	std::ifstream in(argv[1], std::ios::binary);
+	std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if (file.empty())
+	{
+		std::cout << "ERROR::JPEG_KERNELS cannot read " << argv[1] << std::endl;
+		return 1;
+	}
+	if (!stbi__avx2_available())
+	{
+		std::cout << "ERROR::JPEG_KERNELS this CPU has no AVX2" << std::endl;
+		return 1;
+	}
+
+	bool identical = checkKernels();
+	std::cout << (identical ? "kernels identical to the scalar ones" : "ERROR::JPEG_KERNELS kernels differ") << std::endl;
+	benchmarkKernels(runs);
+
+	double sse2, avx2;
+	std::vector<unsigned char> sse2Pixels, avx2Pixels;
+	stbi__avx2_disabled = 1;
+	if (!decode(file, runs, sse2, sse2Pixels))
+		return 1;
+	stbi__avx2_disabled = 0;
+	if (!decode(file, runs, avx2, avx2Pixels))
+		return 1;
+	bool same = sse2Pixels == avx2Pixels;
+	std::cout << "decode: SSE2 " << sse2 << " ms, AVX2 " << avx2 << " ms, x" << sse2 / avx2 <<
+		(same ? "" : " MISMATCH") << std::endl;
+	return identical && same ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Parity check and benchmark of the fast PNG path in stb_image: inflates the
+// IDAT stream of each PNG with the fast loop and with the simple one, then
+// decodes the whole image with the fast loop and SIMD unfiltering on and
+// off, checking both give the same bytes. Corrupted copies of the stream
+// have to fail or succeed the same way with both loops too.
+//
+//	png_bench ../../../Challenge1/raylib_game_loop_full.png [more.png...] [-runs N]
+//
+// Times are the median of the runs.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
+
+namespace
+{
+	struct Result
+	{
+		double milliseconds = 0.0;
+		std::vector<unsigned char> bytes;
+		bool ok = false;
+	};
+
+	template <typename Run>
+	double median(int runs, Run run)
+	{
+		std::vector<double> times;
+		for (int i = 0; i < runs; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			run();
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+
+	unsigned int bigEndian(const unsigned char* p)
+	{
+		return (unsigned int)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+	}
+
+	// the zlib stream: every IDAT chunk put together
+	std::vector<unsigned char> idatStream(const std::vector<unsigned char>& file)
+	{
+		std::vector<unsigned char> stream;
+		size_t at = 8;
+		while (at + 12 <= file.size())
+		{
+			unsigned int length = bigEndian(&file[at]);
+			if (at + 12 + length > file.size())
+				break;
+			if (std::memcmp(&file[at + 4], "IDAT", 4) == 0)
+				stream.insert(stream.end(), file.begin() + at + 8, file.begin() + at + 8 + length);
+			at += 12 + length;
+		}
+		return stream;
+	}
+
+	// into a buffer of the right size, made beforehand: the time is the decoder's
+	// only, without growing the output or touching new pages
+	Result inflate(const std::vector<unsigned char>& stream, int runs, bool fast, size_t size)
+	{
+		Result result;
+		std::vector<char> out(size);
+		int length = -1;
+		stbi__zfast_disabled = !fast;
+		result.milliseconds = median(runs, [&]() {
+			length = stbi_zlib_decode_buffer(out.data(), (int)out.size(), (const char*)stream.data(), (int)stream.size());
+		});
+		result.ok = length >= 0;
+		result.bytes.assign(out.begin(), out.begin() + std::max(length, 0));
+		return result;
+	}
+
+	Result decode(const std::vector<unsigned char>& file, int runs, bool fast)
+	{
+		Result result;
+		stbi__zfast_disabled = !fast;
+#ifdef STBI_SSE2
+		stbi__png_simd_disabled = !fast;
+#endif
+		result.milliseconds = median(runs, [&]() {
+			int width, height, channels;
+			unsigned char* pixels = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 0);
+			result.ok = pixels != nullptr;
+			if (pixels)
+				result.bytes.assign(pixels, pixels + (size_t)width * height * channels);
+			stbi_image_free(pixels);
+		});
+		return result;
+	}
+
+	bool same(const Result& a, const Result& b)
+	{
+		return a.ok == b.ok && a.bytes == b.bytes;
+	}
+
+	// flips a few random bytes of the stream, many times over
+	bool fuzz(const std::vector<unsigned char>& stream, size_t size, int copies)
+	{
+		std::mt19937 random(1234);
+		int failures = 0;
+		for (int copy = 0; copy < copies; copy++)
+		{
+			std::vector<unsigned char> corrupt = stream;
+			int flips = 1 + (int)(random() % 4);
+			for (int flip = 0; flip < flips; flip++)
+				corrupt[2 + random() % (corrupt.size() - 2)] ^= (unsigned char)(1 + random() % 255);
+			Result simple = inflate(corrupt, 1, false, size), fast = inflate(corrupt, 1, true, size);
+			if (!same(simple, fast))
+			{
+				std::cout << "ERROR::PNG_BENCH corrupt stream " << copy << " inflates differently" << std::endl;
+				return false;
+			}
+			failures += !simple.ok;
+		}
+		std::cout << "  " << copies << " corrupt streams agree (" << failures << " rejected)" << std::endl;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> paths;
+	int runs = 20;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "-runs" && i + 1 < argc)
+			runs = std::max(1, std::atoi(argv[++i]));
+		else
+			paths.push_back(argv[i]);
+	}
+	if (paths.empty())
+	{
+		std::cout << "usage: png_bench <image.png>... [-runs N]" << std::endl;
+		return 1;
+	}
+
+	bool identical = true;
+	for (const std::string& path : paths)
+	{
+		std::ifstream in(path, std::ios::binary);
+		std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		std::vector<unsigned char> stream = idatStream(file);
+		if (stream.size() < 8)
+		{
+			std::cout << "ERROR::PNG_BENCH cannot read " << path << std::endl;
+			identical = false;
+			continue;
+		}
+		std::cout << path << ":" << std::endl;
+
+		// what the PNG inflates to, so the buffer is just big enough
+		int size = 0;
+		STBI_FREE(stbi_zlib_decode_malloc((const char*)stream.data(), (int)stream.size(), &size));
+		Result simple = inflate(stream, runs, false, size), fast = inflate(stream, runs, true, size);
+		bool sameInflate = same(simple, fast) && fast.ok;
+		std::cout << "  inflate " << simple.bytes.size() / 1024 << " KB: " << simple.milliseconds << " -> " <<
+			fast.milliseconds << " ms, x" << simple.milliseconds / fast.milliseconds << (sameInflate ? "" : " MISMATCH") << std::endl;
+
+		Result scalar = decode(file, runs, false), simd = decode(file, runs, true);
+		bool sameDecode = same(scalar, simd) && simd.ok;
+		std::cout << "  decode: " << scalar.milliseconds << " -> " << simd.milliseconds << " ms, x" <<
+			scalar.milliseconds / simd.milliseconds << (sameDecode ? "" : " MISMATCH") << std::endl;
+
+		identical = identical && sameInflate && sameDecode && fuzz(stream, size, 500);
+	}
+	std::cout << (identical ? "output identical to the simple decoder" : "ERROR::PNG_BENCH output differs") << std::endl;
+	return identical ? 0 : 1;
+}
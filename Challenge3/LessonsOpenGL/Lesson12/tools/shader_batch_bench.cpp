@@ -0,0 +1,118 @@
+// Benchmark of ShaderBatch: builds many variants of the lesson's programs
+// through one batch, first with the driver compiling on a single thread, then
+// with as many compiler threads as it likes (GL_KHR/ARB_parallel_shader_compile).
+//
+//	shader_batch_bench [variants]
+//
+// Run it from the lesson directory (it reads res/). Build it with ../Shader.cpp,
+// ../ShaderBatch.cpp, ../ShaderCompiler.cpp, ../ShaderPreprocessor.cpp,
+// ../ShaderCache.cpp, ../MappedFile.cpp, ../FrameData.cpp, ../GLState.cpp,
+// glad, GLFW and glm. Every variant gets defines no earlier run
+// used, so neither the program binary cache nor the driver's own cache can
+// skip a compile.
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "../Shader.h"
+#include "../ShaderBatch.h"
+#include "../ShaderCache.h"
+
+namespace
+{
+	struct Timing
+	{
+		double submitMs;
+		double readyMs;
+		bool valid;
+	};
+
+	// serial: the driver is asked for no compiler threads, so the programs
+	// compile one after the other as in a plain glCompileShader loop
+	Timing build(int variants, bool parallel, const std::string& salt)
+	{
+		auto start = std::chrono::steady_clock::now();
+		ShaderBatch batch;
+		if (!parallel)
+		{
+			if (GLAD_GL_KHR_parallel_shader_compile)
+				glMaxShaderCompilerThreadsKHR(0);
+			else if (GLAD_GL_ARB_parallel_shader_compile)
+				glMaxShaderCompilerThreadsARB(0);
+		}
+		std::string mode = parallel ? "1" : "0";
+		for (int i = 0; i < variants; i++)
+		{
+			ShaderDefines defines = { { "BENCH_SALT", salt }, { "BENCH_PARALLEL", mode }, { "BENCH_VARIANT", std::to_string(i) } };
+			// half text, half cube, as the game builds them
+			if (i % 2 == 0)
+			{
+				defines.push_back({ "TEXT", "1" });
+				batch.add("res/vertexshader.vs", "res/fragmentshader.fs", defines);
+			}
+			else
+				batch.add("res/cube.opt.vs", "res/fragmentshader.fs", defines);
+		}
+		Timing timing;
+		timing.submitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		timing.valid = batch.finish();
+		timing.readyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return timing;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int variants = argc > 1 ? std::atoi(argv[1]) : 64;
+	if (variants < 1)
+	{
+		std::cout << "usage: shader_batch_bench [variants]" << std::endl;
+		return 1;
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(1, 1, "shader_batch_bench", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "ERROR::SHADER_BATCH_BENCH cannot create a GL context" << std::endl;
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "ERROR::SHADER_BATCH_BENCH cannot load GL" << std::endl;
+		glfwTerminate();
+		return 1;
+	}
+	if (!Shader::parallelCompileSupported())
+		std::cout << "no parallel shader compile on this driver: both runs are serial" << std::endl;
+
+	// binaries go to a directory of their own, removed afterwards
+	ShaderCache::directory = "cache/bench_programs";
+	std::string salt = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+	Timing serial = build(variants, false, salt);
+	std::cout << "serial: submitted in " << serial.submitMs << " ms, ready after " << serial.readyMs << " ms" << std::endl;
+	Timing parallel = build(variants, true, salt);
+	std::cout << "parallel: submitted in " << parallel.submitMs << " ms, ready after " << parallel.readyMs <<
+		" ms, x" << serial.readyMs / parallel.readyMs << std::endl;
+
+	std::error_code ec;
+	std::filesystem::remove_all(ShaderCache::directory, ec);
+	glfwTerminate();
+	bool valid = serial.valid && parallel.valid;
+	if (!valid)
+		std::cout << "ERROR::SHADER_BATCH_BENCH some variants did not build" << std::endl;
+	return valid ? 0 : 1;
+}
@@ -0,0 +1,403 @@
+// Offline texture converter: decodes an image once, builds its whole mip
+// chain and block-compresses every level into a DDS file, which the game
+// uploads with glCompressedTexImage2D without decoding anything.
+//
+//	texconv textures/wall.jpg textures/wall.dds [bc1|bc3|bc4] [--linear]
+//
+// bc1 (DXT1, 4 bits per texel) is the default for opaque images, bc3 (DXT5,
+// 8 bits) for images with alpha, bc4 (RGTC1, 4 bits, red channel only) for
+// single channel data such as glyph coverage. Mips are averaged in linear
+// light unless --linear says the texels already are linear data.
+//
+// The encoders fit each 4x4 block along its principal color axis: not the
+// best quality a slow exhaustive search would give, but deterministic and
+// fast enough to run on every asset build.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
+
+namespace
+{
+	enum Format { BC1, BC3, BC4 };
+
+	// one mip level, 4 channels per texel
+	struct Level
+	{
+		int width;
+		int height;
+		std::vector<uint8_t> rgba;
+	};
+
+	// DDS layout (all little endian)
+	struct DdsPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t masks[4];
+	};
+	struct DdsHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+	static_assert(sizeof(DdsHeader) == 124, "DDS header is 124 bytes");
+
+	uint32_t fourCC(const char* code)
+	{
+		return (uint32_t)code[0] | ((uint32_t)code[1] << 8) | ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+	}
+
+	float srgbToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float c)
+	{
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// 2x2 box filter; odd sizes repeat their last row/column
+	Level downsample(const Level& source, bool linearData)
+	{
+		static float toLinear[256];
+		static bool tableReady = false;
+		if (!tableReady)
+		{
+			for (int i = 0; i < 256; i++)
+				toLinear[i] = srgbToLinear(i / 255.0f);
+			tableReady = true;
+		}
+
+		Level level;
+		level.width = std::max(1, source.width / 2);
+		level.height = std::max(1, source.height / 2);
+		level.rgba.resize((size_t)level.width * level.height * 4);
+		for (int y = 0; y < level.height; y++)
+		{
+			for (int x = 0; x < level.width; x++)
+			{
+				int x0 = std::min(2 * x, source.width - 1), x1 = std::min(2 * x + 1, source.width - 1);
+				int y0 = std::min(2 * y, source.height - 1), y1 = std::min(2 * y + 1, source.height - 1);
+				const uint8_t* texels[4] = {
+					&source.rgba[((size_t)y0 * source.width + x0) * 4], &source.rgba[((size_t)y0 * source.width + x1) * 4],
+					&source.rgba[((size_t)y1 * source.width + x0) * 4], &source.rgba[((size_t)y1 * source.width + x1) * 4]
+				};
+				uint8_t* out = &level.rgba[((size_t)y * level.width + x) * 4];
+				for (int c = 0; c < 4; c++)
+				{
+					// alpha and linear data are averaged as they are
+					bool gamma = !linearData && c < 3;
+					float sum = 0.0f;
+					for (const uint8_t* texel : texels)
+						sum += gamma ? toLinear[texel[c]] : texel[c] / 255.0f;
+					float value = sum / 4.0f;
+					if (gamma)
+						value = linearToSrgb(value);
+					out[c] = (uint8_t)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+				}
+			}
+		}
+		return level;
+	}
+
+	uint16_t to565(const float color[3])
+	{
+		int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+		int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+		int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void from565(uint16_t c, int color[3])
+	{
+		int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// BC1 color block: endpoints on the principal axis of the block's colors
+	void encodeColor(const uint8_t block[16][4], uint8_t out[8])
+	{
+		float mean[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < 3; c++)
+				mean[c] += block[i][c] / 16.0f;
+		float cov[6] = { 0, 0, 0, 0, 0, 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+			cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+			cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+		}
+		// power iteration for the dominant eigenvector
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[3] = {
+				cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+				cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+				cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+			};
+			float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+			if (length < 1e-6f)
+				break;
+			for (int c = 0; c < 3; c++)
+				axis[c] = next[c] / length;
+		}
+
+		float minT = 0.0f, maxT = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		// inset the endpoints a little: the extremes are rarely worth a whole palette entry
+		float inset = (maxT - minT) / 16.0f;
+		minT += inset;
+		maxT -= inset;
+		float high[3], low[3];
+		for (int c = 0; c < 3; c++)
+		{
+			high[c] = mean[c] + axis[c] * maxT;
+			low[c] = mean[c] + axis[c] * minT;
+		}
+		uint16_t c0 = to565(high), c1 = to565(low);
+		// color0 > color1 selects the four color mode
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		int palette[4][3];
+		from565(c0, palette[0]);
+		from565(c1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		uint32_t indices = 0;
+		if (c0 != c1)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestError = 1 << 30;
+				for (int p = 0; p < 4; p++)
+				{
+					int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+					int error = dr * dr + dg * dg + db * db;
+					if (error < bestError)
+					{
+						bestError = error;
+						best = p;
+					}
+				}
+				indices |= (uint32_t)best << (2 * i);
+			}
+		}
+		out[0] = c0 & 0xFF;
+		out[1] = c0 >> 8;
+		out[2] = c1 & 0xFF;
+		out[3] = c1 >> 8;
+		for (int i = 0; i < 4; i++)
+			out[4 + i] = (indices >> (8 * i)) & 0xFF;
+	}
+
+	// BC4 block (also the alpha half of BC3): eight values between the extremes
+	void encodeChannel(const uint8_t block[16][4], int channel, uint8_t out[8])
+	{
+		int high = 0, low = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			high = std::max(high, (int)block[i][channel]);
+			low = std::min(low, (int)block[i][channel]);
+		}
+		out[0] = (uint8_t)high;
+		out[1] = (uint8_t)low;
+		uint64_t indices = 0;
+		if (high != low)
+		{
+			// high > low: index 0 is high, 1 is low, 2..7 interpolate from high to low
+			int palette[8] = { high, low };
+			for (int p = 2; p < 8; p++)
+				palette[p] = ((8 - p) * high + (p - 1) * low) / 7;
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestError = 1 << 30;
+				for (int p = 0; p < 8; p++)
+				{
+					int error = std::abs(block[i][channel] - palette[p]);
+					if (error < bestError)
+					{
+						bestError = error;
+						best = p;
+					}
+				}
+				indices |= (uint64_t)best << (3 * i);
+			}
+		}
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (indices >> (8 * i)) & 0xFF;
+	}
+
+	std::vector<uint8_t> compress(const Level& level, Format format)
+	{
+		int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+		size_t blockBytes = format == BC3 ? 16 : 8;
+		std::vector<uint8_t> out((size_t)blocksX * blocksY * blockBytes);
+		uint8_t* write = out.data();
+		for (int by = 0; by < blocksY; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				// blocks past the edge of small levels repeat the last texels
+				uint8_t block[16][4];
+				for (int i = 0; i < 16; i++)
+				{
+					int x = std::min(bx * 4 + i % 4, level.width - 1);
+					int y = std::min(by * 4 + i / 4, level.height - 1);
+					memcpy(block[i], &level.rgba[((size_t)y * level.width + x) * 4], 4);
+				}
+				switch (format)
+				{
+				case BC1:
+					encodeColor(block, write);
+					break;
+				case BC3:
+					encodeChannel(block, 3, write);
+					encodeColor(block, write + 8);
+					break;
+				case BC4:
+					encodeChannel(block, 0, write);
+					break;
+				}
+				write += blockBytes;
+			}
+		}
+		return out;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cout << "usage: texconv <input image> <output.dds> [bc1|bc3|bc4] [--linear]" << std::endl;
+		return 1;
+	}
+	std::string input = argv[1], output = argv[2], formatName;
+	bool linearData = false;
+	for (int i = 3; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--linear")
+			linearData = true;
+		else
+			formatName = arg;
+	}
+
+	int width, height, channels;
+	uint8_t* pixels = stbi_load(input.c_str(), &width, &height, &channels, 4);
+	if (!pixels)
+	{
+		std::cout << "ERROR::TEXCONV " << input << ": " << stbi_failure_reason() << std::endl;
+		return 1;
+	}
+	Level base;
+	base.width = width;
+	base.height = height;
+	base.rgba.assign(pixels, pixels + (size_t)width * height * 4);
+	stbi_image_free(pixels);
+
+	Format format;
+	if (formatName.empty())
+	{
+		bool alpha = false;
+		for (size_t i = 3; i < base.rgba.size() && !alpha; i += 4)
+			alpha = base.rgba[i] != 255;
+		format = channels == 1 ? BC4 : alpha ? BC3 : BC1;
+	}
+	else if (formatName == "bc1")
+		format = BC1;
+	else if (formatName == "bc3")
+		format = BC3;
+	else if (formatName == "bc4")
+		format = BC4;
+	else
+	{
+		std::cout << "ERROR::TEXCONV unknown format " << formatName << std::endl;
+		return 1;
+	}
+	// single channel data (coverage, heights...) is not color
+	if (format == BC4)
+		linearData = true;
+
+	// every level down to 1x1
+	std::vector<std::vector<uint8_t>> levels;
+	Level level = base;
+	for (;;)
+	{
+		levels.push_back(compress(level, format));
+		if (level.width == 1 && level.height == 1)
+			break;
+		level = downsample(level, linearData);
+	}
+
+	DdsHeader header;
+	memset(&header, 0, sizeof(header));
+	header.size = sizeof(DdsHeader);
+	// CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT | LINEARSIZE
+	header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+	header.height = height;
+	header.width = width;
+	header.pitchOrLinearSize = (uint32_t)levels[0].size();
+	header.mipMapCount = (uint32_t)levels.size();
+	header.pixelFormat.size = sizeof(DdsPixelFormat);
+	header.pixelFormat.flags = 0x4;	// FOURCC
+	header.pixelFormat.fourCC = fourCC(format == BC1 ? "DXT1" : format == BC3 ? "DXT5" : "BC4U");
+	// TEXTURE | COMPLEX | MIPMAP
+	header.caps = 0x1000 | 0x8 | 0x400000;
+
+	std::ofstream file(output, std::ios::binary);
+	file.write("DDS ", 4);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	size_t total = 0;
+	for (const std::vector<uint8_t>& data : levels)
+	{
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		total += data.size();
+	}
+	if (!file)
+	{
+		std::cout << "ERROR::TEXCONV " << output << ": cannot write" << std::endl;
+		return 1;
+	}
+	const char* names[] = { "bc1", "bc3", "bc4" };
+	std::cout << input << " -> " << output << ": " << width << "x" << height << " " << names[format] << ", " <<
+		levels.size() << " levels, " << total << " bytes (" << (size_t)width * height * channels << " uncompressed, top level)" << std::endl;
+	return 0;
+}